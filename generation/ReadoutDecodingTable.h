@@ -0,0 +1,206 @@
+//
+// Dense tables between DAQ ids and channel ids, indexed by id. Ids without a channel map to `kUnmappedId`.
+//
+
+#pragma once
+
+#include <TDirectory.h>
+#include <TRestDetectorReadout.h>
+#include <TRestDetectorReadoutChannel.h>
+#include <TRestDetectorReadoutModule.h>
+#include <TRestDetectorReadoutPlane.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "ReadoutUtils.h"
+
+struct ReadoutDecodingTable {
+    static constexpr int kUnmappedId = -1;
+
+    int daqIdMin = 0;
+    int channelIdMin = 0;
+
+    std::vector<int> daqToChannel;  // channel id of DAQ id daqIdMin + i
+    std::vector<int> daqToPlane;    // readout plane index of DAQ id daqIdMin + i
+    std::vector<int> channelToDaq;  // DAQ id of channel id channelIdMin + i
+
+    // Offset of `id` in a table starting at `idMin`, computed in unsigned arithmetic so that it cannot overflow:
+    // ids below `idMin` wrap to large values, and a single comparison with the table size checks both bounds
+    static unsigned int GetOffset(int id, int idMin) {
+        return static_cast<unsigned int>(id) - static_cast<unsigned int>(idMin);
+    }
+
+    static int Lookup(const std::vector<int>& table, int id, int idMin) {
+        const unsigned int offset = GetOffset(id, idMin);
+        return offset < table.size() ? table[offset] : kUnmappedId;
+    }
+
+    int GetChannelId(int daqId) const { return Lookup(daqToChannel, daqId, daqIdMin); }
+    int GetPlaneIndex(int daqId) const { return Lookup(daqToPlane, daqId, daqIdMin); }
+    int GetDaqId(int channelId) const { return Lookup(channelToDaq, channelId, channelIdMin); }
+
+    // Translates `n` ids through `table` in a single branch free pass, out of range ids read the first entry and
+    // are then replaced by `kUnmappedId`
+    static void Translate(const std::vector<int>& table, int idMin, const int* ids, int* result, size_t n) {
+        if (table.empty()) {
+            std::fill(result, result + n, kUnmappedId);
+            return;
+        }
+        const int* data = table.data();
+        const unsigned int size = table.size();
+        for (size_t i = 0; i < n; i++) {
+            const unsigned int offset = GetOffset(ids[i], idMin);
+            const bool mapped = offset < size;
+            const int value = data[mapped ? offset : 0];
+            result[i] = mapped ? value : kUnmappedId;
+        }
+    }
+
+    void TranslateDaqIds(const int* daqIds, int* channelIds, size_t n) const {
+        Translate(daqToChannel, daqIdMin, daqIds, channelIds, n);
+    }
+    void TranslateDaqIdsToPlanes(const int* daqIds, int* planeIndices, size_t n) const {
+        Translate(daqToPlane, daqIdMin, daqIds, planeIndices, n);
+    }
+    void TranslateChannelIds(const int* channelIds, int* daqIds, size_t n) const {
+        Translate(channelToDaq, channelIdMin, channelIds, daqIds, n);
+    }
+
+    std::vector<int> TranslateDaqIds(const std::vector<int>& daqIds) const {
+        std::vector<int> channelIds(daqIds.size());
+        TranslateDaqIds(daqIds.data(), channelIds.data(), daqIds.size());
+        return channelIds;
+    }
+    std::vector<int> TranslateChannelIds(const std::vector<int>& channelIds) const {
+        std::vector<int> daqIds(channelIds.size());
+        TranslateChannelIds(channelIds.data(), daqIds.data(), channelIds.size());
+        return daqIds;
+    }
+
+    size_t GetNumberOfMappedIds() const {
+        return daqToChannel.size() - std::count(daqToChannel.begin(), daqToChannel.end(), kUnmappedId);
+    }
+
+    void Write(TDirectory* directory) const {
+        WriteParameters(directory, "decodingOffsets", {double(daqIdMin), double(channelIdMin)});
+        directory->WriteObject(&daqToChannel, "decodingDaqToChannel");
+        directory->WriteObject(&daqToPlane, "decodingDaqToPlane");
+        directory->WriteObject(&channelToDaq, "decodingChannelToDaq");
+    }
+
+    bool Read(TDirectory* directory) {
+        std::vector<double> offsets;
+        if (!ReadParameters(directory, "decodingOffsets", 2, offsets) ||
+            !ReadObject(directory, "decodingDaqToChannel", daqToChannel) ||
+            !ReadObject(directory, "decodingDaqToPlane", daqToPlane) ||
+            !ReadObject(directory, "decodingChannelToDaq", channelToDaq)) {
+            return false;
+        }
+        daqIdMin = static_cast<int>(offsets[0]);
+        channelIdMin = static_cast<int>(offsets[1]);
+        return daqToChannel.size() == daqToPlane.size();
+    }
+};
+
+// Builds the tables from all the channels of the readout. Returns false if a DAQ id or a channel id is used by
+// more than one channel.
+inline bool BuildReadoutDecodingTable(TRestDetectorReadout* readout, ReadoutDecodingTable& table) {
+    struct Entry {
+        int daqId;
+        int channelId;
+        int planeIndex;
+    };
+    std::vector<Entry> entries;
+    for (int p = 0; p < readout->GetNumberOfReadoutPlanes(); p++) {
+        auto plane = readout->GetReadoutPlane(p);
+        for (int m = 0; m < plane->GetNumberOfModules(); m++) {
+            auto module = plane->GetModule(m);
+            for (int c = 0; c < module->GetNumberOfChannels(); c++) {
+                auto channel = module->GetChannel(c);
+                entries.push_back({channel->GetDaqID(), channel->GetChannelId(), p});
+            }
+        }
+    }
+
+    table = ReadoutDecodingTable();
+    if (entries.empty()) {
+        return true;
+    }
+
+    int daqIdMax = entries[0].daqId, channelIdMax = entries[0].channelId;
+    table.daqIdMin = entries[0].daqId;
+    table.channelIdMin = entries[0].channelId;
+    for (const auto& entry : entries) {
+        table.daqIdMin = std::min(table.daqIdMin, entry.daqId);
+        table.channelIdMin = std::min(table.channelIdMin, entry.channelId);
+        daqIdMax = std::max(daqIdMax, entry.daqId);
+        channelIdMax = std::max(channelIdMax, entry.channelId);
+    }
+
+    table.daqToChannel.assign(daqIdMax - table.daqIdMin + 1, ReadoutDecodingTable::kUnmappedId);
+    table.daqToPlane.assign(daqIdMax - table.daqIdMin + 1, ReadoutDecodingTable::kUnmappedId);
+    table.channelToDaq.assign(channelIdMax - table.channelIdMin + 1, ReadoutDecodingTable::kUnmappedId);
+    for (const auto& entry : entries) {
+        int& channelId = table.daqToChannel[entry.daqId - table.daqIdMin];
+        int& daqId = table.channelToDaq[entry.channelId - table.channelIdMin];
+        if (channelId != ReadoutDecodingTable::kUnmappedId || daqId != ReadoutDecodingTable::kUnmappedId) {
+            std::cerr << "DAQ ID " << entry.daqId << " or channel ID " << entry.channelId
+                      << " is used by more than one channel" << std::endl;
+            return false;
+        }
+        channelId = entry.channelId;
+        daqId = entry.daqId;
+        table.daqToPlane[entry.daqId - table.daqIdMin] = entry.planeIndex;
+    }
+
+    return true;
+}
+
+// Compares the tables with the channels of the readout, including ids just outside the table ranges. Returns the
+// number of wrong translations.
+inline size_t CheckReadoutDecodingTable(const ReadoutDecodingTable& table, TRestDetectorReadout* readout) {
+    std::vector<int> daqIds, channelIds, planeIndices;
+    for (int p = 0; p < readout->GetNumberOfReadoutPlanes(); p++) {
+        auto plane = readout->GetReadoutPlane(p);
+        for (int m = 0; m < plane->GetNumberOfModules(); m++) {
+            auto module = plane->GetModule(m);
+            for (int c = 0; c < module->GetNumberOfChannels(); c++) {
+                auto channel = module->GetChannel(c);
+                daqIds.push_back(channel->GetDaqID());
+                channelIds.push_back(channel->GetChannelId());
+                planeIndices.push_back(p);
+            }
+        }
+    }
+
+    size_t errors = 0;
+    const auto channelIdsFromTable = table.TranslateDaqIds(daqIds);
+    const auto daqIdsFromTable = table.TranslateChannelIds(channelIds);
+    for (size_t i = 0; i < daqIds.size(); i++) {
+        if (channelIdsFromTable[i] != channelIds[i] || daqIdsFromTable[i] != daqIds[i] ||
+            table.GetPlaneIndex(daqIds[i]) != planeIndices[i]) {
+            std::cerr << "Decoding table mismatch for DAQ ID " << daqIds[i] << " and channel ID " << channelIds[i]
+                      << std::endl;
+            errors++;
+        }
+    }
+    if (table.GetNumberOfMappedIds() != daqIds.size()) {
+        std::cerr << "Decoding table maps " << table.GetNumberOfMappedIds() << " DAQ IDs instead of "
+                  << daqIds.size() << std::endl;
+        errors++;
+    }
+
+    const int outOfRange[] = {table.daqIdMin - 1, table.daqIdMin + static_cast<int>(table.daqToChannel.size()),
+                              std::numeric_limits<int>::min(), std::numeric_limits<int>::max()};
+    for (const int daqId : outOfRange) {
+        if (table.GetChannelId(daqId) != ReadoutDecodingTable::kUnmappedId) {
+            errors++;
+        }
+    }
+
+    return errors;
+}
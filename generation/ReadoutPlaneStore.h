@@ -0,0 +1,171 @@
+//
+// Readout planes stored as separate records, so that a readout can be loaded with only some of its planes. Planes
+// shared by several readouts are written once. Plane indices are the positions in the complete readout. Plane IDs are
+// only unique within a type (the TPC plane and the first veto plane both have ID 0), so they are always selected
+// together with the type.
+//
+
+#pragma once
+
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TRestDetectorReadout.h>
+#include <TRestDetectorReadoutPlane.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ReadoutUtils.h"
+
+struct ReadoutPlaneStore {
+    std::vector<std::string> planeKeys;
+    std::vector<std::string> planeTypes;
+    std::vector<int> planeIds;
+
+    std::vector<std::string> readoutNames;
+    std::map<std::string, std::vector<int>> readoutPlanes;  // positions in planeKeys of the planes of each readout
+
+    // Writes the plane record to `directory` and returns its position in the store
+    int AddPlane(TDirectory* directory, TRestDetectorReadoutPlane* plane) {
+        const int position = planeKeys.size();
+        const std::string key = "plane" + std::to_string(position);
+        directory->WriteObject(plane, key.c_str());
+        planeKeys.push_back(key);
+        planeTypes.push_back(plane->GetType());
+        planeIds.push_back(plane->GetID());
+        return position;
+    }
+
+    // Adds a readout made of the stored `planes`, false if two of them have the same type and ID
+    bool AddReadout(const std::string& readoutName, const std::vector<int>& planes) {
+        for (size_t a = 0; a < planes.size(); a++) {
+            for (size_t b = a + 1; b < planes.size(); b++) {
+                if (planeTypes[planes[a]] == planeTypes[planes[b]] && planeIds[planes[a]] == planeIds[planes[b]]) {
+                    std::cerr << "Readout " << readoutName << " has two planes of type '" << planeTypes[planes[a]]
+                              << "' with ID " << planeIds[planes[a]] << std::endl;
+                    return false;
+                }
+            }
+        }
+        if (!readoutPlanes.count(readoutName)) {
+            readoutNames.push_back(readoutName);
+        }
+        readoutPlanes[readoutName] = planes;
+        return true;
+    }
+
+    // Positions in the complete readout of the planes matching `type` (any if empty) and `ids` (any if empty). IDs
+    // can only be selected together with a type.
+    std::vector<int> GetPlaneIndices(const std::string& readoutName, const std::string& type = "",
+                                     const std::vector<int>& ids = {}) const {
+        std::vector<int> indices;
+        const auto readout = readoutPlanes.find(readoutName);
+        if (readout == readoutPlanes.end()) {
+            return indices;
+        }
+        if (type.empty() && !ids.empty()) {
+            std::cerr << "Readout plane IDs are only unique within a type, select the type too" << std::endl;
+            return indices;
+        }
+        for (size_t i = 0; i < readout->second.size(); i++) {
+            const int plane = readout->second[i];
+            const bool typeMatches = type.empty() || planeTypes[plane] == type;
+            const bool idMatches = ids.empty() || std::find(ids.begin(), ids.end(), planeIds[plane]) != ids.end();
+            if (typeMatches && idMatches) {
+                indices.push_back(i);
+            }
+        }
+        return indices;
+    }
+
+    // Builds a readout with the selected planes only, reading their records from `directory`. Plane `i` of the
+    // returned readout is plane `planeIndices[i]` of the complete readout. Returns nullptr if a record is missing.
+    TRestDetectorReadout* LoadReadout(TDirectory* directory, const std::string& readoutName,
+                                      const std::string& type = "", const std::vector<int>& ids = {},
+                                      std::vector<int>* planeIndices = nullptr) const {
+        const auto indices = GetPlaneIndices(readoutName, type, ids);
+        if (indices.empty()) {
+            std::cerr << "No planes of readout " << readoutName << " match the selection" << std::endl;
+            return nullptr;
+        }
+        if (planeIndices) {
+            *planeIndices = indices;
+        }
+        return LoadReadoutPlanes(directory, readoutName, indices);
+    }
+
+    // Builds a readout with the planes at `indices` of the complete readout, in that order. Returns nullptr if an
+    // index is out of range or a record is missing.
+    TRestDetectorReadout* LoadReadoutPlanes(TDirectory* directory, const std::string& readoutName,
+                                            const std::vector<int>& indices) const {
+        const auto readoutPlanesIt = readoutPlanes.find(readoutName);
+        if (readoutPlanesIt == readoutPlanes.end()) {
+            std::cerr << "Readout " << readoutName << " not found in the plane store" << std::endl;
+            return nullptr;
+        }
+        const std::vector<int>& planes = readoutPlanesIt->second;
+
+        auto readout = new TRestDetectorReadout();
+        readout->SetName(readoutName.c_str());
+        for (const int index : indices) {
+            if (index < 0 || index >= static_cast<int>(planes.size())) {
+                std::cerr << "Readout " << readoutName << " has no plane " << index << std::endl;
+                delete readout;
+                return nullptr;
+            }
+            const std::string& key = planeKeys[planes[index]];
+            TRestDetectorReadoutPlane* plane = nullptr;
+            directory->GetObject(key.c_str(), plane);
+            if (!plane) {
+                std::cerr << "Readout plane " << key << " not found" << std::endl;
+                delete readout;
+                return nullptr;
+            }
+            readout->AddReadoutPlane(*plane);
+            delete plane;
+        }
+        return readout;
+    }
+
+    void Write(TDirectory* directory) const {
+        directory->WriteObject(&planeKeys, "planeKeys");
+        directory->WriteObject(&planeTypes, "planeTypes");
+        directory->WriteObject(&planeIds, "planeIds");
+        directory->WriteObject(&readoutNames, "readoutNames");
+        for (const auto& readoutName : readoutNames) {
+            directory->WriteObject(&readoutPlanes.at(readoutName), (readoutName + "_planes").c_str());
+        }
+    }
+
+    bool Read(TDirectory* directory) {
+        if (!ReadObject(directory, "planeKeys", planeKeys) || !ReadObject(directory, "planeTypes", planeTypes) ||
+            !ReadObject(directory, "planeIds", planeIds) || !ReadObject(directory, "readoutNames", readoutNames)) {
+            return false;
+        }
+        readoutPlanes.clear();
+        for (const auto& readoutName : readoutNames) {
+            if (!ReadObject(directory, (readoutName + "_planes").c_str(), readoutPlanes[readoutName])) {
+                return false;
+            }
+        }
+        return planeKeys.size() == planeTypes.size() && planeKeys.size() == planeIds.size();
+    }
+};
+
+// Readout `readoutName` of `file`: the complete readout object if the file has it, otherwise assembled from the plane
+// store in `directoryName`. Returns nullptr if neither is found.
+inline TRestDetectorReadout* LoadReadoutFromFile(TFile* file, const std::string& readoutName,
+                                                 const std::string& directoryName = "readoutPlanes") {
+    if (auto readout = file->Get<TRestDetectorReadout>(readoutName.c_str())) {
+        return readout;
+    }
+    TDirectory* directory = file->GetDirectory(directoryName.c_str());
+    ReadoutPlaneStore store;
+    if (!directory || !store.Read(directory)) {
+        return nullptr;
+    }
+    return store.LoadReadout(directory, readoutName);
+}
@@ -0,0 +1,197 @@
+//
+// Helpers shared by the readout lookup tables and by the validation and benchmark macros.
+//
+
+#pragma once
+
+#include <TDirectory.h>
+#include <TRestDetectorReadout.h>
+#include <TVectorD.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Writes `parameters` to `directory` as a TVectorD record
+inline void WriteParameters(TDirectory* directory, const char* name, const std::vector<double>& parameters) {
+    TVectorD record(parameters.size(), parameters.data());
+    directory->WriteTObject(&record, name);
+}
+
+// Reads a record written by `WriteParameters`, false if it is missing or does not have `size` values
+inline bool ReadParameters(TDirectory* directory, const char* name, size_t size, std::vector<double>& parameters) {
+    TVectorD* record = nullptr;
+    directory->GetObject(name, record);
+    if (!record) {
+        return false;
+    }
+    parameters.assign(record->GetMatrixArray(), record->GetMatrixArray() + record->GetNrows());
+    delete record;
+    return parameters.size() == size;
+}
+
+// Reads an object written by `TDirectory::WriteObject`, false if it is missing
+template <class T>
+bool ReadObject(TDirectory* directory, const char* name, T& object) {
+    T* fromFile = nullptr;
+    directory->GetObject(name, fromFile);
+    if (!fromFile) {
+        return false;
+    }
+    object = std::move(*fromFile);
+    delete fromFile;
+    return true;
+}
+
+// `requested` threads, or one per core if it is not positive
+inline int GetNumberOfThreads(int requested) {
+    return requested > 0 ? requested : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// Runs `worker(t)` for t = 0 ... nThreads - 1, each one on its own thread, and waits for all of them
+template <class Worker>
+void RunThreads(int nThreads, Worker worker) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Copies of the readout, one per thread: the readout queries are not thread safe
+inline std::vector<std::unique_ptr<TRestDetectorReadout>> CloneReadout(TRestDetectorReadout* readout, int copies) {
+    std::vector<std::unique_ptr<TRestDetectorReadout>> clones;
+    for (int i = 0; i < copies; i++) {
+        clones.emplace_back(dynamic_cast<TRestDetectorReadout*>(readout->Clone()));
+    }
+    return clones;
+}
+
+// Adds the per-thread `counts` to `total`, element by element
+template <class T>
+void AddCounts(std::vector<T>& total, const std::vector<T>& counts) {
+    for (size_t i = 0; i < total.size(); i++) {
+        total[i] += counts[i];
+    }
+}
+
+// `filename` with its extension replaced by ".json"
+inline std::string GetJsonFilename(const std::string& filename) {
+    return filename.substr(0, filename.find_last_of('.')) + ".json";
+}
+
+// Minimal JSON writer for the macro summaries. Values go to the innermost open object or array, objects and arrays
+// opened as `inlined` are written on a single line. Non finite numbers are written as null.
+class JsonWriter {
+   public:
+    JsonWriter() { Open('{', false); }
+
+    template <class T>
+    JsonWriter& Add(const std::string& key, const T& value) {
+        Key(key);
+        WriteValue(value);
+        return *this;
+    }
+
+    JsonWriter& BeginObject(const std::string& key = "", bool inlined = false) {
+        Key(key);
+        Open('{', inlined);
+        return *this;
+    }
+
+    JsonWriter& BeginArray(const std::string& key = "", bool inlined = false) {
+        Key(key);
+        Open('[', inlined);
+        return *this;
+    }
+
+    JsonWriter& End() {
+        const Level level = levels.back();
+        levels.pop_back();
+        if (!level.empty && !level.inlined) {
+            NewLine();
+        }
+        stream << level.close;
+        return *this;
+    }
+
+    // Closes the open objects and arrays and writes the document
+    bool Write(const std::string& filename) {
+        while (!levels.empty()) {
+            End();
+        }
+        std::ofstream file(filename);
+        file << stream.str() << "\n";
+        return file.good();
+    }
+
+   private:
+    struct Level {
+        char close;
+        bool inlined;
+        bool empty;
+    };
+
+    std::ostringstream stream;
+    std::vector<Level> levels;
+
+    void NewLine() { stream << "\n" << std::string(2 * levels.size(), ' '); }
+
+    void Key(const std::string& key) {
+        Level& level = levels.back();
+        if (!level.empty) {
+            stream << (level.inlined ? ", " : ",");
+        }
+        if (!level.inlined) {
+            NewLine();
+        }
+        level.empty = false;
+        if (!key.empty()) {
+            WriteValue(key);
+            stream << ": ";
+        }
+    }
+
+    void Open(char bracket, bool inlined) {
+        stream << bracket;
+        // inside an inlined level everything is inlined
+        const bool parentInlined = !levels.empty() && levels.back().inlined;
+        levels.push_back({bracket == '{' ? '}' : ']', inlined || parentInlined, true});
+    }
+
+    void WriteValue(const std::string& value) {
+        stream << '"';
+        for (const char c : value) {
+            if (c == '"' || c == '\\') {
+                stream << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                stream << ' ';
+            } else {
+                stream << c;
+            }
+        }
+        stream << '"';
+    }
+
+    void WriteValue(const char* value) { WriteValue(std::string(value)); }
+
+    void WriteValue(bool value) { stream << (value ? "true" : "false"); }
+
+    template <class T>
+    void WriteValue(const T& value) {
+        static_assert(std::is_arithmetic<T>::value, "JSON values must be numbers, booleans or strings");
+        if (std::is_floating_point<T>::value && !std::isfinite(static_cast<double>(value))) {
+            stream << "null";
+        } else {
+            stream << value;
+        }
+    }
+};
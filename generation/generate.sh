@@ -4,11 +4,16 @@
 cd ./micromegas/
 restRoot -q -b GenerateReadoutsMicromegas.C
 
-# Generate veto readouts
+# Generate veto readouts from the GDML geometry. With --restG4 the geometry is also built by restG4 (simulation.sh)
+# and the veto volumes read from the GDML geometry are compared with it
 
 cd ../vetos/
-bash simulation.sh
-restRoot -q -b GenerateReadoutsWithVetoSystem.C
+if [ "$1" == "--restG4" ]; then
+    bash simulation.sh
+    restRoot -q -b 'GenerateReadoutsWithVetoSystem.C("setup.gdml", true, false, "simulation.root")'
+else
+    restRoot -q -b GenerateReadoutsWithVetoSystem.C
+fi
 
 cd ..
 ls -lht ../readouts/
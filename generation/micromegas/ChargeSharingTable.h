@@ -0,0 +1,374 @@
+//
+// Tabulated charge sharing of a gaussian cloud between diamond strips, as a function of the sub-pitch offset and
+// of the cloud sigma. Strip channels come from a `ParametricStripModule`, edge pixels are treated as diamonds.
+// `CheckChargeSharingWithPixels` compares the fractions with electrons sampled over the expanded readout pixels.
+//
+
+#pragma once
+
+#include <TDirectory.h>
+#include <TMath.h>
+#include <TRestDetectorReadout.h>
+#include <TVector2.h>
+#include <TVector3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../ReadoutUtils.h"
+#include "ParametricStripModule.h"
+#include "ReadoutRasterLookup.h"
+
+namespace chargeSharing {
+
+// Fraction of a gaussian cloud falling on the diamond of diagonal `pitch` centered at `center` (relative to the
+// cloud center)
+inline double DiamondIntegral(const TVector2& center, double pitch, double sigma) {
+    const double xi = (center.X() + center.Y()) / TMath::Sqrt(2.);
+    const double eta = (center.X() - center.Y()) / TMath::Sqrt(2.);
+    const double half = pitch / (2 * TMath::Sqrt(2.));
+    const double scale = 1.0 / (sigma * TMath::Sqrt(2.));
+    return 0.25 * (std::erf((xi + half) * scale) - std::erf((xi - half) * scale)) *
+           (std::erf((eta + half) * scale) - std::erf((eta - half) * scale));
+}
+
+// Fractions on the X strips (rows) `strip - R ... strip + R` and the Y strips (columns) `column - R ...
+// column + R` of a cloud at lattice position (column + offsetX, strip + offsetY), in pitch units relative to the
+// lattice origin of the module (the center of an X strip diamond)
+inline void StripFractions(double offsetX, double offsetY, double pitch, double sigma, int R,
+                           double* xFractions, double* yFractions) {
+    const int K = static_cast<int>(std::ceil(6 * sigma / pitch)) + 1;
+    for (int m = -R; m <= R; m++) {
+        double x = 0, y = 0;
+        for (int k = -K; k <= K + 1; k++) {
+            // X strip m: diamonds at (k, m), Y strip m: diamonds at (m + 1/2, k + 1/2)
+            x += DiamondIntegral(TVector2((k - offsetX) * pitch, (m - offsetY) * pitch), pitch, sigma);
+            y += DiamondIntegral(TVector2((m + 0.5 - offsetX) * pitch, (k + 0.5 - offsetY) * pitch), pitch,
+                                 sigma);
+        }
+        xFractions[m + R] = x;
+        yFractions[m + R] = y;
+    }
+}
+
+}  // namespace chargeSharing
+
+struct ChargeSharingTable {
+    double pitch = 0;
+    int subdivisions = 0;        // offset nodes are 0, 1 / subdivisions, ..., 1 in pitch units, along x and y
+    int R = 0;                   // strips tabulated on each side of the cloud center strip
+    std::vector<double> sigmas;  // increasing, log spaced
+
+    // fractions[((s * (n + 1) + i) * (n + 1) + j) * (2 * R + 1) + m + R] for sigma s, offset node (i, j), strip m.
+    // Single precision is well within the interpolation error.
+    std::vector<float> xFractions;
+    std::vector<float> yFractions;
+
+    // DAQ id of the strips of the module, -1 if there is no strip. The table is the same for all the modules with
+    // the same pitch, only these depend on the module. The module is not owned: it must outlive the table, or be
+    // unset with `SetStripModule(nullptr)` before it is destroyed.
+    const ParametricStripModule* stripModule = nullptr;
+    int xStripFirst = 0;
+    int yStripFirst = 0;
+    std::vector<int> xStripDaqIds;
+    std::vector<int> yStripDaqIds;
+
+    size_t GetIndex(int s, int i, int j) const {
+        return ((static_cast<size_t>(s) * (subdivisions + 1) + i) * (subdivisions + 1) + j) * (2 * R + 1);
+    }
+
+    size_t GetSizeInBytes() const {
+        return (xFractions.size() + yFractions.size()) * sizeof(float) + sigmas.size() * sizeof(double);
+    }
+
+    // Strip channels of the module, probed slightly inside the diamond position of each strip so that edge
+    // strips made of special pixels are also found. `nullptr` unsets the module.
+    void SetStripModule(const ParametricStripModule* module) {
+        stripModule = module;
+        if (!module) {
+            xStripDaqIds.clear();
+            yStripDaqIds.clear();
+            return;
+        }
+        const int rows = static_cast<int>(std::ceil(module->size.Y() / module->pitch)) + 3;
+        const int columns = static_cast<int>(std::ceil(module->size.X() / module->pitch)) + 3;
+        const double probe = module->pitch / 8.0;
+        const double xMiddle = module->size.X() / 2.0, yMiddle = module->size.Y() / 2.0;
+
+        // lattice position of the module corner, in strips
+        xStripFirst = static_cast<int>(std::floor(-module->latticeOrigin.Y() / module->pitch)) - 1;
+        yStripFirst = static_cast<int>(std::floor(-module->latticeOrigin.X() / module->pitch)) - 1;
+        xStripDaqIds.assign(rows, -1);
+        yStripDaqIds.assign(columns, -1);
+        for (int r = 0; r < rows; r++) {
+            const double y = module->latticeOrigin.Y() + (xStripFirst + r) * module->pitch;
+            // closest X strip diamond center to the middle of the module
+            const double x = module->latticeOrigin.X() +
+                             std::round((xMiddle - module->latticeOrigin.X()) / module->pitch) * module->pitch;
+            const int channel = module->FindChannel(TVector2(x, y - probe));
+            xStripDaqIds[r] = channel == -1 ? -1 : module->channelDaqIds[channel];
+        }
+        for (int c = 0; c < columns; c++) {
+            const double x = module->latticeOrigin.X() + (yStripFirst + c + 0.5) * module->pitch;
+            const double y = module->latticeOrigin.Y() +
+                             (std::round((yMiddle - module->latticeOrigin.Y()) / module->pitch - 0.5) + 0.5) *
+                                 module->pitch;
+            const int channel = module->FindChannel(TVector2(x, y - probe));
+            yStripDaqIds[c] = channel == -1 ? -1 : module->channelDaqIds[channel];
+        }
+    }
+
+    // `strips` holds the fractions of the strips `center - R ... center + R`. Keeps, in place, those with a channel
+    // and a fraction above `threshold`, as (DAQ id, fraction) pairs.
+    void SelectStrips(int center, int stripFirst, const std::vector<int>& stripDaqIds, double threshold,
+                      std::vector<std::pair<int, double>>& strips) const {
+        size_t n = 0;
+        for (int m = 0; m < 2 * R + 1; m++) {
+            const int s = center + m - R - stripFirst;
+            if (strips[m].second > threshold && s >= 0 && s < static_cast<int>(stripDaqIds.size()) &&
+                stripDaqIds[s] != -1) {
+                strips[n++] = {stripDaqIds[s], strips[m].second};
+            }
+        }
+        strips.resize(n);
+    }
+
+    // Fractions of the charge of a gaussian cloud of `sigma` centered at `hit` on each X and Y strip, as
+    // (DAQ id, fraction) pairs. Sigma is clamped to the tabulated range. There are none without a strip module.
+    // The fractions are accumulated in `xStrips` and `yStrips`, which do not allocate once they have grown to
+    // 2 * R + 1 entries.
+    void GetChargeFractions(const TVector3& hit, double sigma, std::vector<std::pair<int, double>>& xStrips,
+                            std::vector<std::pair<int, double>>& yStrips, double threshold = 1E-9) const {
+        xStrips.clear();
+        yStrips.clear();
+        if (!stripModule) {
+            return;
+        }
+        const double distance = (hit - stripModule->position).Dot(stripModule->normal);
+        if (distance < 0 || distance > stripModule->height) {
+            return;
+        }
+        const TVector2 point = stripModule->GetModuleCoordinates(hit);
+        const double u = (point.X() - stripModule->latticeOrigin.X()) / pitch;
+        const double v = (point.Y() - stripModule->latticeOrigin.Y()) / pitch;
+        const int column = static_cast<int>(std::floor(u)), strip = static_cast<int>(std::floor(v));
+
+        // interpolation nodes and weights
+        const double clampedSigma = std::min(std::max(sigma, sigmas.front()), sigmas.back());
+        const int s0 = std::min(static_cast<int>(std::upper_bound(sigmas.begin(), sigmas.end(), clampedSigma) -
+                                                 sigmas.begin()) - 1,
+                                static_cast<int>(sigmas.size()) - 2);
+        const double ws = std::log(clampedSigma / sigmas[s0]) / std::log(sigmas[s0 + 1] / sigmas[s0]);
+        const double fu = (u - column) * subdivisions, fv = (v - strip) * subdivisions;
+        const int i0 = std::min(static_cast<int>(fu), subdivisions - 1);
+        const int j0 = std::min(static_cast<int>(fv), subdivisions - 1);
+        const double wi = fu - i0, wj = fv - j0;
+
+        const int nStrips = 2 * R + 1;
+        xStrips.assign(nStrips, {-1, 0.0});
+        yStrips.assign(nStrips, {-1, 0.0});
+        for (int ds = 0; ds < 2; ds++) {
+            for (int di = 0; di < 2; di++) {
+                for (int dj = 0; dj < 2; dj++) {
+                    const double weight =
+                        (ds ? ws : 1 - ws) * (di ? wi : 1 - wi) * (dj ? wj : 1 - wj);
+                    const size_t index = GetIndex(s0 + ds, i0 + di, j0 + dj);
+                    for (int m = 0; m < nStrips; m++) {
+                        xStrips[m].second += weight * xFractions[index + m];
+                        yStrips[m].second += weight * yFractions[index + m];
+                    }
+                }
+            }
+        }
+
+        SelectStrips(strip, xStripFirst, xStripDaqIds, threshold, xStrips);
+        SelectStrips(column, yStripFirst, yStripDaqIds, threshold, yStrips);
+    }
+
+    // Same as `GetChargeFractions` computed directly from the diamond integrals, without the tables
+    void GetChargeFractionsDirect(const TVector3& hit, double sigma, std::vector<std::pair<int, double>>& xStrips,
+                                  std::vector<std::pair<int, double>>& yStrips, double threshold = 1E-9) const {
+        xStrips.clear();
+        yStrips.clear();
+        if (!stripModule) {
+            return;
+        }
+        const double distance = (hit - stripModule->position).Dot(stripModule->normal);
+        if (distance < 0 || distance > stripModule->height) {
+            return;
+        }
+        const TVector2 point = stripModule->GetModuleCoordinates(hit);
+        const double u = (point.X() - stripModule->latticeOrigin.X()) / pitch;
+        const double v = (point.Y() - stripModule->latticeOrigin.Y()) / pitch;
+        const int column = static_cast<int>(std::floor(u)), strip = static_cast<int>(std::floor(v));
+
+        const int nStrips = 2 * R + 1;
+        std::vector<double> x(nStrips), y(nStrips);
+        chargeSharing::StripFractions(u - column, v - strip, pitch, sigma, R, x.data(), y.data());
+        for (int m = 0; m < nStrips; m++) {
+            xStrips.emplace_back(-1, x[m]);
+            yStrips.emplace_back(-1, y[m]);
+        }
+
+        SelectStrips(strip, xStripFirst, xStripDaqIds, threshold, xStrips);
+        SelectStrips(column, yStripFirst, yStripDaqIds, threshold, yStrips);
+    }
+
+    // The table only, the strip module is written separately
+    void Write(TDirectory* directory) const {
+        WriteParameters(directory, "chargeSharingParameters", {pitch, double(subdivisions), double(R)});
+        directory->WriteObject(&sigmas, "chargeSharingSigmas");
+        directory->WriteObject(&xFractions, "chargeSharingXFractions");
+        directory->WriteObject(&yFractions, "chargeSharingYFractions");
+    }
+
+    // Reads the table and sets the strip module, which can be read with `ParametricStripModule::Read`. Fails if the
+    // table was computed for another pitch than the module's.
+    bool Read(TDirectory* directory, const ParametricStripModule* module) {
+        std::vector<double> parameters;
+        if (!ReadParameters(directory, "chargeSharingParameters", 3, parameters) ||
+            !ReadObject(directory, "chargeSharingSigmas", sigmas) ||
+            !ReadObject(directory, "chargeSharingXFractions", xFractions) ||
+            !ReadObject(directory, "chargeSharingYFractions", yFractions)) {
+            return false;
+        }
+        pitch = parameters[0];
+        subdivisions = static_cast<int>(parameters[1]);
+        R = static_cast<int>(parameters[2]);
+        if (sigmas.size() < 2 || xFractions.size() != GetIndex(sigmas.size(), 0, 0) ||
+            yFractions.size() != xFractions.size() || !module ||
+            std::abs(pitch - module->pitch) > module->tolerance) {
+            return false;
+        }
+        SetStripModule(module);
+        return true;
+    }
+};
+
+// Tabulates the strip fractions for `nSigmas` log spaced sigmas between `sigmaMin` and `sigmaMax`
+inline ChargeSharingTable BuildChargeSharingTable(double pitch, int subdivisions, double sigmaMin,
+                                                  double sigmaMax, int nSigmas) {
+    ChargeSharingTable table;
+    table.pitch = pitch;
+    table.subdivisions = subdivisions;
+    table.R = static_cast<int>(std::ceil(6 * sigmaMax / pitch)) + 1;
+    for (int s = 0; s < nSigmas; s++) {
+        table.sigmas.push_back(sigmaMin * std::pow(sigmaMax / sigmaMin, static_cast<double>(s) / (nSigmas - 1)));
+    }
+
+    const int nStrips = 2 * table.R + 1;
+    std::vector<double> x(nStrips), y(nStrips);
+    table.xFractions.resize(table.GetIndex(nSigmas, 0, 0));
+    table.yFractions.resize(table.xFractions.size());
+    for (int s = 0; s < nSigmas; s++) {
+        for (int i = 0; i <= subdivisions; i++) {
+            for (int j = 0; j <= subdivisions; j++) {
+                chargeSharing::StripFractions(static_cast<double>(i) / subdivisions,
+                                              static_cast<double>(j) / subdivisions, pitch, table.sigmas[s],
+                                              table.R, x.data(), y.data());
+                const size_t index = table.GetIndex(s, i, j);
+                std::copy(x.begin(), x.end(), table.xFractions.begin() + index);
+                std::copy(y.begin(), y.end(), table.yFractions.begin() + index);
+            }
+        }
+    }
+    return table;
+}
+
+// Compares the interpolated fractions with the direct computation for random hits over the module and sigmas in
+// the tabulated range. Returns the largest difference in the fraction of a strip, 1 without a strip module.
+inline double CheckChargeSharingTable(const ChargeSharingTable& table, int nHits, unsigned int seed = 17022) {
+    if (!table.stripModule) {
+        return 1;
+    }
+    const ParametricStripModule& module = *table.stripModule;
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    double maxDifference = 0;
+    std::vector<std::pair<int, double>> x, y, xDirect, yDirect;
+    for (int h = 0; h < nHits; h++) {
+        const TVector2 modulePoint(uniform(generator) * module.size.X(), uniform(generator) * module.size.Y());
+        const TVector2 planePoint = module.origin + modulePoint.Rotate(module.rotation * TMath::DegToRad());
+        const TVector3 hit = module.position + module.axisX * planePoint.X() + module.axisY * planePoint.Y() +
+                             module.normal * (module.height / 2.0);
+        const double sigma = table.sigmas.front() * std::pow(table.sigmas.back() / table.sigmas.front(),
+                                                              uniform(generator));
+
+        // no threshold, so both give the same strips
+        table.GetChargeFractions(hit, sigma, x, y, -1);
+        table.GetChargeFractionsDirect(hit, sigma, xDirect, yDirect, -1);
+        if (x.size() != xDirect.size() || y.size() != yDirect.size()) {
+            return 1;
+        }
+        for (size_t i = 0; i < x.size(); i++) {
+            maxDifference = std::max(maxDifference, std::abs(x[i].second - xDirect[i].second));
+        }
+        for (size_t i = 0; i < y.size(); i++) {
+            maxDifference = std::max(maxDifference, std::abs(y[i].second - yDirect[i].second));
+        }
+    }
+
+    return maxDifference;
+}
+
+// Compares the fractions of the table with those of `nSamples` electrons drawn from the gaussian cloud and assigned to
+// the channels of the expanded pixels (through the raster lookup, which gives the same channels as the readout), for
+// random hits and sigmas away from the module edges, whose pixels are not diamonds. Returns the largest difference in
+// the fraction of a channel, which includes a sampling error of up to 0.5 / sqrt(nSamples), and 1 without a strip
+// module.
+inline double CheckChargeSharingWithPixels(const ChargeSharingTable& table, const ReadoutRasterLookup& lookup,
+                                           TRestDetectorReadout* readout, int nHits, int nSamples,
+                                           unsigned int seed = 17022) {
+    if (!table.stripModule) {
+        return 1;
+    }
+    const ParametricStripModule& module = *table.stripModule;
+    const double margin = 6 * table.sigmas.back();
+    if (module.size.X() <= 2 * margin || module.size.Y() <= 2 * margin) {
+        return 1;
+    }
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> gaussian(0, 1);
+
+    double maxDifference = 0;
+    std::vector<std::pair<int, double>> x, y;
+    std::map<int, double> fractions;
+    for (int h = 0; h < nHits; h++) {
+        const TVector2 modulePoint(margin + uniform(generator) * (module.size.X() - 2 * margin),
+                                   margin + uniform(generator) * (module.size.Y() - 2 * margin));
+        const double sigma = table.sigmas.front() * std::pow(table.sigmas.back() / table.sigmas.front(),
+                                                              uniform(generator));
+
+        // the cloud is round, so it is sampled in module coordinates
+        fractions.clear();
+        for (int e = 0; e < nSamples; e++) {
+            const TVector2 electron(modulePoint.X() + sigma * gaussian(generator),
+                                    modulePoint.Y() + sigma * gaussian(generator));
+            const TVector2 planePoint = module.origin + electron.Rotate(module.rotation * TMath::DegToRad());
+            const TVector3 point = module.position + module.axisX * planePoint.X() +
+                                   module.axisY * planePoint.Y() + module.normal * (module.height / 2.0);
+            fractions[lookup.FindDaqId(point, readout)] += 1.0 / nSamples;
+        }
+
+        const TVector2 planePoint = module.origin + modulePoint.Rotate(module.rotation * TMath::DegToRad());
+        const TVector3 hit = module.position + module.axisX * planePoint.X() + module.axisY * planePoint.Y() +
+                             module.normal * (module.height / 2.0);
+        table.GetChargeFractions(hit, sigma, x, y, -1);
+        for (const auto& strips : {&x, &y}) {
+            for (const auto& [daqId, fraction] : *strips) {
+                fractions[daqId] -= fraction;
+            }
+        }
+        for (const auto& [daqId, difference] : fractions) {
+            maxDifference = std::max(maxDifference, std::abs(difference));
+        }
+    }
+
+    return maxDifference;
+}
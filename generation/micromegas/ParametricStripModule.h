@@ -0,0 +1,429 @@
+//
+// Parametric description of a strip module made of diamond pixels: the diamond lattice, the channel of each strip
+// and the few edge pixels kept explicitly. It is not a REST readout and does not replace the expanded one: it gives
+// the geometry and the strip channels to the charge sharing table. `CheckParametricStripModule` compares its channels
+// with the expanded module pixels.
+//
+
+#pragma once
+
+#include <TDirectory.h>
+#include <TMath.h>
+#include <TRestDetectorReadout.h>
+#include <TRestDetectorReadoutChannel.h>
+#include <TRestDetectorReadoutModule.h>
+#include <TRestDetectorReadoutPixel.h>
+#include <TRestDetectorReadoutPlane.h>
+#include <TVector2.h>
+#include <TVector3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "../ReadoutUtils.h"
+
+struct ParametricStripModule {
+    struct Pixel {
+        int channel;  // channel index in the module
+        TVector2 origin;
+        TVector2 size;
+        double rotation;  // degrees
+        bool triangle;
+
+        // meant to follow `TRestDetectorReadoutPixel::IsInside`, compared with it by `CheckParametricStripModule`
+        bool IsInside(const TVector2& point, double tolerance) const {
+            const TVector2 local = (point - origin).Rotate(-rotation * TMath::DegToRad());
+            if (local.X() < -tolerance || local.X() > size.X() + tolerance || local.Y() < -tolerance ||
+                local.Y() > size.Y() + tolerance) {
+                return false;
+            }
+            return !triangle || local.Y() <= size.Y() * (1.0 - local.X() / size.X()) + tolerance;
+        }
+    };
+
+    // readout plane frame
+    TVector3 position;
+    TVector3 normal;
+    TVector3 axisX;
+    TVector3 axisY;
+    double height = 0;
+
+    // module geometry in readout plane coordinates
+    TVector2 origin;
+    TVector2 size;
+    double rotation = 0;
+    double tolerance = 1.E-4;
+
+    double pitch = 0;
+    TVector2 latticeOrigin;  // center of an X strip diamond, in module coordinates
+
+    // lattice coordinates are a = 2 * column, b = 2 * strip for the X strips and a = 2 * strip + 1,
+    // b = 2 * row + 1 for the Y strips
+    int xColumnMin = 0, xColumnMax = -1, xStripMin = 0, xStripMax = -1;
+    int yRowMin = 0, yRowMax = -1, yStripMin = 0, yStripMax = -1;
+    std::vector<int> xStripChannels;  // channel index of each X strip, starting at xStripMin
+    std::vector<int> yStripChannels;  // channel index of each Y strip, starting at yStripMin
+
+    std::vector<int> channelIds;     // per channel index
+    std::vector<int> channelDaqIds;  // per channel index
+
+    std::vector<Pixel> specialPixels;
+
+    // special pixels overlapping each cell of a pitch sized grid over the module, not stored
+    std::vector<std::vector<int>> specialPixelCells;
+    int cellsX = 0, cellsY = 0;
+
+    double GetDiamondSize() const { return pitch / TMath::Sqrt(2.); }
+
+    // The diamond at lattice coordinates (a, b) as a pixel, or false if there is none
+    bool GetDiamond(int a, int b, Pixel& diamond) const {
+        int channel = -1;
+        if (a % 2 == 0 && b % 2 == 0) {
+            const int column = a / 2, strip = b / 2;
+            if (column >= xColumnMin && column <= xColumnMax && strip >= xStripMin && strip <= xStripMax) {
+                channel = xStripChannels[strip - xStripMin];
+            }
+        } else if (a % 2 != 0 && b % 2 != 0) {
+            const int strip = (a - 1) / 2, row = (b - 1) / 2;
+            if (row >= yRowMin && row <= yRowMax && strip >= yStripMin && strip <= yStripMax) {
+                channel = yStripChannels[strip - yStripMin];
+            }
+        }
+        if (channel == -1) {
+            return false;
+        }
+        const double diamondSize = GetDiamondSize();
+        const TVector2 center = latticeOrigin + TVector2(a * pitch / 2.0, b * pitch / 2.0);
+        diamond = {channel, center - TVector2(0, pitch / 2.0), TVector2(diamondSize, diamondSize), 45, false};
+        return true;
+    }
+
+    // Channel index at a point in module coordinates, -1 if there is none. When pixels of several channels
+    // contain the point (within the tolerance) the first channel is returned, as the expanded module does.
+    int FindChannel(const TVector2& point) const {
+        if (point.X() < 0 || point.Y() < 0 || point.X() > size.X() || point.Y() > size.Y()) {
+            return -1;
+        }
+
+        // rotated lattice coordinates, the diamonds are the unit squares centered at even (s, t)
+        const double u = (point.X() - latticeOrigin.X()) / (pitch / 2.0);
+        const double v = (point.Y() - latticeOrigin.Y()) / (pitch / 2.0);
+        const double s = u + v, t = u - v;
+        const int centerS = 2 * static_cast<int>(std::floor(s / 2.0 + 0.5));
+        const int centerT = 2 * static_cast<int>(std::floor(t / 2.0 + 0.5));
+
+        int channel = -1;
+        auto add = [&channel](int candidate) {
+            if (channel == -1 || candidate < channel) {
+                channel = candidate;
+            }
+        };
+
+        // diamonds closer than the tolerance to the point
+        const double margin = 4 * tolerance * TMath::Sqrt(2.) / (pitch / 2.0);
+        const int stepS = s - centerS > 1 - margin ? 2 : (s - centerS < -1 + margin ? -2 : 0);
+        const int stepT = t - centerT > 1 - margin ? 2 : (t - centerT < -1 + margin ? -2 : 0);
+        const bool boundary = stepS != 0 || stepT != 0;
+
+        Pixel diamond;
+        for (int ds = 0; ds <= (stepS != 0); ds++) {
+            for (int dt = 0; dt <= (stepT != 0); dt++) {
+                const int S = centerS + ds * stepS, T = centerT + dt * stepT;
+                if (GetDiamond((S + T) / 2, (S - T) / 2, diamond) &&
+                    (!boundary || diamond.IsInside(point, tolerance))) {
+                    add(diamond.channel);
+                }
+            }
+        }
+
+        const int i = static_cast<int>(std::floor(point.X() / pitch));
+        const int j = static_cast<int>(std::floor(point.Y() / pitch));
+        if (i >= 0 && j >= 0 && i < cellsX && j < cellsY) {
+            for (const int p : specialPixelCells[j * cellsX + i]) {
+                if (specialPixels[p].IsInside(point, tolerance)) {
+                    add(specialPixels[p].channel);
+                }
+            }
+        }
+
+        return channel;
+    }
+
+    TVector2 GetModuleCoordinates(const TVector3& point) const {
+        const TVector3 relative = point - position;
+        const TVector2 planeCoordinates(relative.Dot(axisX), relative.Dot(axisY));
+        return (planeCoordinates - origin).Rotate(-rotation * TMath::DegToRad());
+    }
+
+    // DAQ id of the channel at `point` (-1 if there is none), the same value as the first element of
+    // `TRestDetectorReadout::GetHitsDaqChannelAtReadoutPlane`
+    int FindDaqId(const TVector3& point) const {
+        const double distance = (point - position).Dot(normal);
+        if (distance < 0 || distance > height) {
+            return -1;
+        }
+        const int channel = FindChannel(GetModuleCoordinates(point));
+        return channel == -1 ? -1 : channelDaqIds[channel];
+    }
+
+    void BuildSpecialPixelCells() {
+        cellsX = static_cast<int>(std::ceil(size.X() / pitch));
+        cellsY = static_cast<int>(std::ceil(size.Y() / pitch));
+        specialPixelCells.assign(cellsX * cellsY, {});
+        for (size_t p = 0; p < specialPixels.size(); p++) {
+            const auto& pixel = specialPixels[p];
+            double xMin = 1E30, xMax = -1E30, yMin = 1E30, yMax = -1E30;
+            for (const auto& vertex : {TVector2(0, 0), TVector2(pixel.size.X(), 0), pixel.size,
+                                       TVector2(0, pixel.size.Y())}) {
+                const TVector2 corner = pixel.origin + vertex.Rotate(pixel.rotation * TMath::DegToRad());
+                xMin = std::min(xMin, corner.X());
+                xMax = std::max(xMax, corner.X());
+                yMin = std::min(yMin, corner.Y());
+                yMax = std::max(yMax, corner.Y());
+            }
+            const int iMin = std::max(0, static_cast<int>(std::floor((xMin - 2 * tolerance) / pitch)));
+            const int iMax = std::min(cellsX - 1, static_cast<int>(std::floor((xMax + 2 * tolerance) / pitch)));
+            const int jMin = std::max(0, static_cast<int>(std::floor((yMin - 2 * tolerance) / pitch)));
+            const int jMax = std::min(cellsY - 1, static_cast<int>(std::floor((yMax + 2 * tolerance) / pitch)));
+            for (int j = jMin; j <= jMax; j++) {
+                for (int i = iMin; i <= iMax; i++) {
+                    specialPixelCells[j * cellsX + i].push_back(p);
+                }
+            }
+        }
+    }
+
+    void Write(TDirectory* directory) const {
+        WriteParameters(directory, "stripModuleParameters",
+                        {position.X(), position.Y(), position.Z(), normal.X(), normal.Y(), normal.Z(), axisX.X(),
+                         axisX.Y(), axisX.Z(), height, origin.X(), origin.Y(), size.X(), size.Y(), rotation,
+                         tolerance, pitch, latticeOrigin.X(), latticeOrigin.Y(), double(xColumnMin),
+                         double(xColumnMax), double(xStripMin), double(xStripMax), double(yRowMin),
+                         double(yRowMax), double(yStripMin), double(yStripMax)});
+
+        // channel, origin, size, rotation and triangle of each special pixel
+        std::vector<double> pixels;
+        for (const auto& pixel : specialPixels) {
+            pixels.insert(pixels.end(), {static_cast<double>(pixel.channel), pixel.origin.X(), pixel.origin.Y(),
+                                         pixel.size.X(), pixel.size.Y(), pixel.rotation,
+                                         pixel.triangle ? 1.0 : 0.0});
+        }
+
+        directory->WriteObject(&xStripChannels, "stripModuleXStripChannels");
+        directory->WriteObject(&yStripChannels, "stripModuleYStripChannels");
+        directory->WriteObject(&channelIds, "stripModuleChannelIds");
+        directory->WriteObject(&channelDaqIds, "stripModuleChannelDaqIds");
+        directory->WriteObject(&pixels, "stripModuleSpecialPixels");
+    }
+
+    bool Read(TDirectory* directory) {
+        std::vector<double> p, pixels;
+        if (!ReadParameters(directory, "stripModuleParameters", 27, p) ||
+            !ReadObject(directory, "stripModuleXStripChannels", xStripChannels) ||
+            !ReadObject(directory, "stripModuleYStripChannels", yStripChannels) ||
+            !ReadObject(directory, "stripModuleChannelIds", channelIds) ||
+            !ReadObject(directory, "stripModuleChannelDaqIds", channelDaqIds) ||
+            !ReadObject(directory, "stripModuleSpecialPixels", pixels)) {
+            return false;
+        }
+
+        position = {p[0], p[1], p[2]};
+        normal = {p[3], p[4], p[5]};
+        axisX = {p[6], p[7], p[8]};
+        axisY = normal.Cross(axisX);
+        height = p[9];
+        origin = {p[10], p[11]};
+        size = {p[12], p[13]};
+        rotation = p[14];
+        tolerance = p[15];
+        pitch = p[16];
+        latticeOrigin = {p[17], p[18]};
+        xColumnMin = static_cast<int>(p[19]);
+        xColumnMax = static_cast<int>(p[20]);
+        xStripMin = static_cast<int>(p[21]);
+        xStripMax = static_cast<int>(p[22]);
+        yRowMin = static_cast<int>(p[23]);
+        yRowMax = static_cast<int>(p[24]);
+        yStripMin = static_cast<int>(p[25]);
+        yStripMax = static_cast<int>(p[26]);
+
+        specialPixels.clear();
+        for (size_t i = 0; i + 7 <= pixels.size(); i += 7) {
+            const double* pixel = pixels.data() + i;
+            specialPixels.push_back({static_cast<int>(pixel[0]), {pixel[1], pixel[2]}, {pixel[3], pixel[4]},
+                                     pixel[5], pixel[6] != 0});
+        }
+        BuildSpecialPixelCells();
+
+        return true;
+    }
+};
+
+// Extracts the parametric description of the (single) module of a readout plane. Returns false if the module
+// is not a regular diamond strip pattern.
+inline bool BuildParametricStripModule(TRestDetectorReadout* readout, int planeIndex, double pitch,
+                                       double tolerance, ParametricStripModule& stripModule) {
+    auto plane = readout->GetReadoutPlane(planeIndex);
+    if (plane->GetNumberOfModules() != 1) {
+        std::cerr << "Parametric strip modules require a single module per readout plane" << std::endl;
+        return false;
+    }
+    auto module = plane->GetModule(0);
+
+    stripModule = ParametricStripModule();
+    stripModule.position = plane->GetPosition();
+    stripModule.normal = plane->GetNormal().Unit();
+    stripModule.axisX = plane->GetAxisX().Unit();
+    stripModule.axisY = stripModule.normal.Cross(stripModule.axisX);
+    stripModule.height = plane->GetHeight();
+    stripModule.origin = module->GetOrigin();
+    stripModule.size = module->GetSize();
+    stripModule.rotation = module->GetRotation();
+    stripModule.tolerance = tolerance;
+    stripModule.pitch = pitch;
+
+    const double diamondSize = stripModule.GetDiamondSize();
+    const double epsilon = 1.E-9;
+
+    // centers of the regular diamonds and their channel
+    std::vector<std::pair<TVector2, int>> diamonds;
+    for (int c = 0; c < module->GetNumberOfChannels(); c++) {
+        auto channel = module->GetChannel(c);
+        stripModule.channelIds.push_back(channel->GetChannelId());
+        stripModule.channelDaqIds.push_back(channel->GetDaqID());
+        for (int p = 0; p < channel->GetNumberOfPixels(); p++) {
+            auto pixel = channel->GetPixel(p);
+            const bool isDiamond = std::abs(pixel->GetRotation() - 45) < epsilon && !pixel->GetTriangle() &&
+                                   std::abs(pixel->GetSize().X() - diamondSize) < epsilon &&
+                                   std::abs(pixel->GetSize().Y() - diamondSize) < epsilon;
+            if (isDiamond) {
+                diamonds.emplace_back(pixel->GetOrigin() + TVector2(0, pitch / 2.0), c);
+            } else {
+                stripModule.specialPixels.push_back({c, pixel->GetOrigin(), pixel->GetSize(),
+                                                     pixel->GetRotation(), pixel->GetTriangle()});
+            }
+        }
+    }
+    if (diamonds.size() < 2) {
+        std::cerr << "Not enough diamond pixels for a parametric strip module" << std::endl;
+        return false;
+    }
+
+    // lattice coordinates relative to the first diamond
+    std::vector<std::tuple<int, int, int>> lattice;  // (a, b, channel)
+    for (const auto& [center, channel] : diamonds) {
+        const double a = (center.X() - diamonds[0].first.X()) / (pitch / 2.0);
+        const double b = (center.Y() - diamonds[0].first.Y()) / (pitch / 2.0);
+        const int aInteger = static_cast<int>(std::lround(a)), bInteger = static_cast<int>(std::lround(b));
+        if (std::abs(a - aInteger) > 1.E-6 || std::abs(b - bInteger) > 1.E-6 || (aInteger + bInteger) % 2 != 0) {
+            std::cerr << "Diamond pixel at (" << center.X() << ", " << center.Y() << ") is not on the lattice"
+                      << std::endl;
+            return false;
+        }
+        lattice.emplace_back(aInteger, bInteger, channel);
+    }
+
+    // the X strips (rows) are the diamonds of a channel sharing b, move the lattice origin to one of them
+    bool firstIsRow = false;
+    for (const auto& [a, b, channel] : lattice) {
+        if (channel == std::get<2>(lattice[0]) && (a != 0 || b != 0)) {
+            firstIsRow = b == 0;
+            break;
+        }
+    }
+    const int shift = firstIsRow ? 0 : 1;
+    stripModule.latticeOrigin = diamonds[0].first - TVector2(shift * pitch / 2.0, shift * pitch / 2.0);
+
+    std::map<int, int> xStripChannel, yStripChannel;
+    std::set<std::pair<int, int>> xDiamonds, yDiamonds;
+    for (auto [a, b, channel] : lattice) {
+        a += shift;
+        b += shift;
+        // floor division, lattice coordinates may be negative
+        auto half = [](int value) { return static_cast<int>(std::floor(value / 2.0)); };
+        const bool isRow = std::abs(a) % 2 == 0;
+        auto& stripChannel = isRow ? xStripChannel : yStripChannel;
+        const int strip = isRow ? half(b) : half(a);
+        const int position = isRow ? half(a) : half(b);
+        if (stripChannel.count(strip) && stripChannel[strip] != channel) {
+            std::cerr << "Diamonds of a strip belong to different channels" << std::endl;
+            return false;
+        }
+        stripChannel[strip] = channel;
+        (isRow ? xDiamonds : yDiamonds).insert({strip, position});
+    }
+
+    // diamonds must fill a rectangle of strips x positions
+    auto fillRange = [](const std::set<std::pair<int, int>>& filled, const std::map<int, int>& stripChannel,
+                        int& stripMin, int& stripMax, int& positionMin, int& positionMax,
+                        std::vector<int>& channels) {
+        if (filled.empty()) {
+            return true;
+        }
+        stripMin = filled.begin()->first;
+        stripMax = filled.rbegin()->first;
+        positionMin = 1 << 30;
+        positionMax = -(1 << 30);
+        for (const auto& [strip, position] : filled) {
+            positionMin = std::min(positionMin, position);
+            positionMax = std::max(positionMax, position);
+        }
+        channels.clear();
+        for (int strip = stripMin; strip <= stripMax; strip++) {
+            if (!stripChannel.count(strip)) {
+                return false;
+            }
+            channels.push_back(stripChannel.at(strip));
+        }
+        return filled.size() == static_cast<size_t>(stripMax - stripMin + 1) * (positionMax - positionMin + 1);
+    };
+    if (!fillRange(xDiamonds, xStripChannel, stripModule.xStripMin, stripModule.xStripMax,
+                   stripModule.xColumnMin, stripModule.xColumnMax, stripModule.xStripChannels) ||
+        !fillRange(yDiamonds, yStripChannel, stripModule.yStripMin, stripModule.yStripMax, stripModule.yRowMin,
+                   stripModule.yRowMax, stripModule.yStripChannels)) {
+        std::cerr << "Diamond pixels do not form a regular strip pattern" << std::endl;
+        return false;
+    }
+
+    stripModule.BuildSpecialPixelCells();
+    return true;
+}
+
+// Compares the parametric module with the exact pixel test over a dense grid of points covering the module.
+// Returns the number of points where both disagree.
+inline size_t CheckParametricStripModule(const ParametricStripModule& stripModule,
+                                         TRestDetectorReadout* readout, int planeIndex, double step) {
+    // offset the grid so that points do not fall systematically on pixel boundaries
+    const double offset = step * (TMath::Sqrt(2.) - 1.0);
+    const double moduleRotation = stripModule.rotation * TMath::DegToRad();
+
+    size_t points = 0, mismatches = 0;
+    for (double y = -step + offset; y < stripModule.size.Y() + step; y += step) {
+        for (double x = -step + offset; x < stripModule.size.X() + step; x += step) {
+            const TVector2 planeCoordinates = stripModule.origin + TVector2(x, y).Rotate(moduleRotation);
+            const TVector3 point = stripModule.position + stripModule.axisX * planeCoordinates.X() +
+                                   stripModule.axisY * planeCoordinates.Y() +
+                                   stripModule.normal * (stripModule.height / 2.0);
+            const int exact = std::get<0>(readout->GetHitsDaqChannelAtReadoutPlane(point, planeIndex));
+            const int parametric = stripModule.FindDaqId(point);
+            points++;
+            if (exact != parametric) {
+                if (mismatches < 10) {
+                    std::cerr << "Parametric strip module mismatch at (" << x << ", " << y
+                              << "): parametric DAQ ID " << parametric << ", exact DAQ ID " << exact
+                              << std::endl;
+                }
+                mismatches++;
+            }
+        }
+    }
+
+    std::cout << "Parametric strip module checked at " << points << " points, " << mismatches << " mismatches"
+              << std::endl;
+    return mismatches;
+}
@@ -0,0 +1,518 @@
+//
+// Sub-pitch raster lookup of the channel at a point of a readout plane. Cells crossed by a pixel boundary keep
+// the pixels touching them for the exact test, cells crossed by a module boundary use the full readout query.
+//
+
+#pragma once
+
+#include <TDirectory.h>
+#include <TMath.h>
+#include <TRestDetectorReadout.h>
+#include <TRestDetectorReadoutChannel.h>
+#include <TRestDetectorReadoutModule.h>
+#include <TRestDetectorReadoutPixel.h>
+#include <TRestDetectorReadoutPlane.h>
+#include <TVector2.h>
+#include <TVector3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "../ReadoutUtils.h"
+
+namespace readoutGeometry {
+
+// Vertices (in readout plane coordinates) of a pixel. Rectangles have 4 vertices and triangles 3, following
+// the `TRestDetectorReadoutPixel` convention: the triangle is the half of the rectangle below its diagonal.
+inline std::vector<TVector2> GetPixelPolygon(TRestDetectorReadoutModule* module,
+                                             TRestDetectorReadoutPixel* pixel) {
+    const TVector2 size = pixel->GetSize();
+    std::vector<TVector2> local = {{0, 0}, {size.X(), 0}, {size.X(), size.Y()}, {0, size.Y()}};
+    if (pixel->GetTriangle()) {
+        local.erase(local.begin() + 2);
+    }
+
+    const double pixelRotation = pixel->GetRotation() * TMath::DegToRad();
+    const double moduleRotation = module->GetRotation() * TMath::DegToRad();
+
+    std::vector<TVector2> polygon;
+    for (const auto& vertex : local) {
+        const TVector2 inModule = pixel->GetOrigin() + vertex.Rotate(pixelRotation);
+        polygon.push_back(module->GetOrigin() + inModule.Rotate(moduleRotation));
+    }
+    return polygon;
+}
+
+// Vertices (in readout plane coordinates) of the module active area
+inline std::vector<TVector2> GetModulePolygon(TRestDetectorReadoutModule* module) {
+    const TVector2 size = module->GetSize();
+    const double moduleRotation = module->GetRotation() * TMath::DegToRad();
+
+    std::vector<TVector2> polygon;
+    for (const auto& vertex :
+         std::vector<TVector2>{{0, 0}, {size.X(), 0}, {size.X(), size.Y()}, {0, size.Y()}}) {
+        polygon.push_back(module->GetOrigin() + vertex.Rotate(moduleRotation));
+    }
+    return polygon;
+}
+
+// Signed distance of a point to the boundary of a convex polygon (negative inside)
+inline double DistanceToConvexPolygon(const std::vector<TVector2>& polygon, const TVector2& point) {
+    double area = 0;
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const auto& a = polygon[i];
+        const auto& b = polygon[(i + 1) % polygon.size()];
+        area += a.X() * b.Y() - b.X() * a.Y();
+    }
+    const double orientation = area > 0 ? 1.0 : -1.0;
+
+    double distance = -1E30;
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const auto& a = polygon[i];
+        const auto& b = polygon[(i + 1) % polygon.size()];
+        const TVector2 edge = b - a;
+        // outward normal
+        const TVector2 normal = TVector2(edge.Y(), -edge.X()).Unit() * orientation;
+        distance = std::max(distance, (point - a) * normal);
+    }
+    return distance;
+}
+
+// Separating axis test between a convex polygon grown by `margin` and an axis aligned box
+inline bool ConvexPolygonIntersectsBox(const std::vector<TVector2>& polygon, const TVector2& boxMin,
+                                       const TVector2& boxMax, double margin) {
+    std::vector<TVector2> axes = {{1, 0}, {0, 1}};
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const TVector2 edge = polygon[(i + 1) % polygon.size()] - polygon[i];
+        axes.push_back(TVector2(edge.Y(), -edge.X()).Unit());
+    }
+    const std::vector<TVector2> box = {
+        boxMin, {boxMax.X(), boxMin.Y()}, boxMax, {boxMin.X(), boxMax.Y()}};
+
+    for (const auto& axis : axes) {
+        double polygonMin = 1E30, polygonMax = -1E30, boxProjectionMin = 1E30, boxProjectionMax = -1E30;
+        for (const auto& vertex : polygon) {
+            polygonMin = std::min(polygonMin, vertex * axis);
+            polygonMax = std::max(polygonMax, vertex * axis);
+        }
+        for (const auto& vertex : box) {
+            boxProjectionMin = std::min(boxProjectionMin, vertex * axis);
+            boxProjectionMax = std::max(boxProjectionMax, vertex * axis);
+        }
+        if (polygonMax + margin < boxProjectionMin || boxProjectionMax < polygonMin - margin) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace readoutGeometry
+
+struct ReadoutRasterLookup {
+    // Cell codes: the block slot of the pixel containing the cell, kAmbiguousCell with the mask of the block slots
+    // to test, an empty cell or a cell resolved with the full query
+    static constexpr unsigned short kEmptyCell = 0xFFFF;
+    static constexpr unsigned short kFullQueryCell = 0xFFFE;
+    static constexpr unsigned short kAmbiguousCell = 0x8000;
+    // a mask of 15 slots would reach the empty and full query codes
+    static constexpr int kMaxAmbiguousSlots = 14;
+    static_assert((kAmbiguousCell | ((1 << kMaxAmbiguousSlots) - 1)) < kFullQueryCell,
+                  "ambiguous cell masks must not collide with the reserved cell codes");
+
+    int planeIndex = 0;
+
+    // readout plane frame
+    TVector3 position;
+    TVector3 normal;
+    TVector3 axisX;
+    TVector3 axisY;
+    double height = 0;
+
+    // raster geometry in readout plane coordinates, nX and nY are multiples of blockCells
+    double originX = 0;
+    double originY = 0;
+    double cellSize = 0;
+    int nX = 0;
+    int nY = 0;
+    int blockCells = 1;
+
+    // The raster is split in blocks of blockCells x blockCells cells. The cell codes of a block are pattern
+    // blockPatterns[b] of `patterns`, identical blocks (the regular pixel pattern) share the same one.
+    std::vector<unsigned short> blockPatterns;
+    std::vector<unsigned short> patterns;
+
+    // pixels of the slots of block `b`, encoded with `EncodeCandidate`, are
+    // slotPixels[blockSlotOffsets[b]] ... slotPixels[blockSlotOffsets[b + 1] - 1]
+    std::vector<int> blockSlotOffsets = {0};
+    std::vector<int> slotPixels;
+
+    // DAQ id of channel `c` of module `m` is channelDaqIds[moduleChannelOffsets[m] + c]
+    std::vector<int> moduleChannelOffsets;
+    std::vector<int> channelDaqIds;
+
+    static int EncodeCandidate(int module, int channel, int pixel) {
+        return (module << 24) | (channel << 12) | pixel;
+    }
+
+    int GetDaqId(int candidate) const {
+        return channelDaqIds[moduleChannelOffsets[candidate >> 24] + ((candidate >> 12) & 0xFFF)];
+    }
+
+    size_t GetNumberOfPatterns() const { return patterns.size() / (blockCells * blockCells); }
+
+    size_t GetSizeInBytes() const {
+        return (blockPatterns.size() + patterns.size()) * sizeof(unsigned short) +
+               (blockSlotOffsets.size() + slotPixels.size() + moduleChannelOffsets.size() + channelDaqIds.size()) *
+                   sizeof(int);
+    }
+
+    // Returns the DAQ id of the channel at `point` (-1 if there is none), the same value as the first element
+    // of `TRestDetectorReadout::GetHitsDaqChannelAtReadoutPlane`
+    int FindDaqId(const TVector3& point, TRestDetectorReadout* readout) const {
+        const TVector3 relative = point - position;
+        const double distance = relative.Dot(normal);
+        if (distance < 0 || distance > height) {
+            return -1;
+        }
+        const TVector2 planeCoordinates(relative.Dot(axisX), relative.Dot(axisY));
+        const int i = static_cast<int>(std::floor((planeCoordinates.X() - originX) / cellSize));
+        const int j = static_cast<int>(std::floor((planeCoordinates.Y() - originY) / cellSize));
+        if (i < 0 || j < 0 || i >= nX || j >= nY) {
+            return -1;
+        }
+        const int block = (j / blockCells) * (nX / blockCells) + i / blockCells;
+        const size_t pattern = blockPatterns[block];
+        const unsigned short cell =
+            patterns[(pattern * blockCells + j % blockCells) * blockCells + i % blockCells];
+        if (cell == kEmptyCell) {
+            return -1;
+        }
+        if (cell == kFullQueryCell) {
+            return std::get<0>(readout->GetHitsDaqChannelAtReadoutPlane(point, planeIndex));
+        }
+        const int* slots = slotPixels.data() + blockSlotOffsets[block];
+        if (!(cell & kAmbiguousCell)) {
+            return GetDaqId(slots[cell]);
+        }
+
+        auto plane = readout->GetReadoutPlane(planeIndex);
+        int daqId = -1;
+        for (int slot = 0; slot < kMaxAmbiguousSlots; slot++) {
+            if (!(cell & (1 << slot))) {
+                continue;
+            }
+            const int candidate = slots[slot];
+            auto module = plane->GetModule(candidate >> 24);
+            auto channel = module->GetChannel((candidate >> 12) & 0xFFF);
+            const TVector2 moduleCoordinates = (planeCoordinates - module->GetOrigin())
+                                                   .Rotate(-module->GetRotation() * TMath::DegToRad());
+            if (!channel->GetPixel(candidate & 0xFFF)->IsInside(moduleCoordinates)) {
+                continue;
+            }
+            if (daqId != -1 && daqId != channel->GetDaqID()) {
+                // within the pixel tolerance of two channels, let the readout decide
+                return std::get<0>(readout->GetHitsDaqChannelAtReadoutPlane(point, planeIndex));
+            }
+            daqId = channel->GetDaqID();
+        }
+        return daqId;
+    }
+
+    TVector3 GetPoint(double x, double y) const {
+        return position + axisX * x + axisY * y + normal * (height / 2.0);
+    }
+
+    void Write(TDirectory* directory) const {
+        WriteParameters(directory, "rasterGeometry",
+                        {double(planeIndex), position.X(), position.Y(), position.Z(), normal.X(), normal.Y(),
+                         normal.Z(), axisX.X(), axisX.Y(), axisX.Z(), height, originX, originY, cellSize,
+                         double(nX), double(nY), double(blockCells)});
+        directory->WriteObject(&blockPatterns, "rasterBlockPatterns");
+        directory->WriteObject(&patterns, "rasterPatterns");
+        directory->WriteObject(&blockSlotOffsets, "rasterBlockSlotOffsets");
+        directory->WriteObject(&slotPixels, "rasterSlotPixels");
+        directory->WriteObject(&moduleChannelOffsets, "rasterModuleChannelOffsets");
+        directory->WriteObject(&channelDaqIds, "rasterChannelDaqIds");
+    }
+
+    bool Read(TDirectory* directory) {
+        std::vector<double> geometry;
+        if (!ReadParameters(directory, "rasterGeometry", 17, geometry) ||
+            !ReadObject(directory, "rasterBlockPatterns", blockPatterns) ||
+            !ReadObject(directory, "rasterPatterns", patterns) ||
+            !ReadObject(directory, "rasterBlockSlotOffsets", blockSlotOffsets) ||
+            !ReadObject(directory, "rasterSlotPixels", slotPixels) ||
+            !ReadObject(directory, "rasterModuleChannelOffsets", moduleChannelOffsets) ||
+            !ReadObject(directory, "rasterChannelDaqIds", channelDaqIds)) {
+            return false;
+        }
+        planeIndex = static_cast<int>(geometry[0]);
+        position = {geometry[1], geometry[2], geometry[3]};
+        normal = {geometry[4], geometry[5], geometry[6]};
+        axisX = {geometry[7], geometry[8], geometry[9]};
+        axisY = normal.Cross(axisX);
+        height = geometry[10];
+        originX = geometry[11];
+        originY = geometry[12];
+        cellSize = geometry[13];
+        nX = static_cast<int>(geometry[14]);
+        nY = static_cast<int>(geometry[15]);
+        blockCells = static_cast<int>(geometry[16]);
+        const size_t nBlocks = static_cast<size_t>(nX / blockCells) * (nY / blockCells);
+        return blockCells > 0 && nX % blockCells == 0 && nY % blockCells == 0 &&
+               blockPatterns.size() == nBlocks && blockSlotOffsets.size() == nBlocks + 1;
+    }
+};
+
+// Builds the raster of a readout plane with cells of size `pitch / subdivisions`. `tolerance` must be larger
+// than the pixel tolerance used by the exact test: pixels closer than this to a cell are candidates of it.
+inline ReadoutRasterLookup BuildRasterLookup(TRestDetectorReadout* readout, int planeIndex, double pitch,
+                                             int subdivisions, double tolerance = 1.E-3) {
+    using namespace readoutGeometry;
+
+    auto plane = readout->GetReadoutPlane(planeIndex);
+
+    ReadoutRasterLookup lookup;
+    lookup.planeIndex = planeIndex;
+    lookup.position = plane->GetPosition();
+    lookup.normal = plane->GetNormal().Unit();
+    lookup.axisX = plane->GetAxisX().Unit();
+    lookup.axisY = lookup.normal.Cross(lookup.axisX);
+    lookup.height = plane->GetHeight();
+    lookup.cellSize = pitch / subdivisions;
+
+    // raster extent: bounding box of all the modules, with one extra cell on each side
+    double xMin = 1E30, xMax = -1E30, yMin = 1E30, yMax = -1E30;
+    for (int m = 0; m < plane->GetNumberOfModules(); m++) {
+        for (const auto& vertex : GetModulePolygon(plane->GetModule(m))) {
+            xMin = std::min(xMin, vertex.X());
+            xMax = std::max(xMax, vertex.X());
+            yMin = std::min(yMin, vertex.Y());
+            yMax = std::max(yMax, vertex.Y());
+        }
+    }
+    lookup.originX = xMin - lookup.cellSize;
+    lookup.originY = yMin - lookup.cellSize;
+    // blocks of one pitch, aligned with the pixel pattern when the modules are
+    lookup.blockCells = subdivisions;
+    const int nBlocksX = (static_cast<int>(std::ceil((xMax - xMin) / lookup.cellSize)) + 1) / subdivisions + 1;
+    const int nBlocksY = (static_cast<int>(std::ceil((yMax - yMin) / lookup.cellSize)) + 1) / subdivisions + 1;
+    lookup.nX = nBlocksX * subdivisions;
+    lookup.nY = nBlocksY * subdivisions;
+
+    const size_t nCells = static_cast<size_t>(lookup.nX) * lookup.nY;
+    // the cell is fully inside a pixel
+    std::vector<bool> covered(nCells, false);
+    // pixels touching the cell
+    std::vector<std::vector<int>> candidates(nCells);
+    // the channels of the candidates differ
+    std::vector<bool> severalChannels(nCells, false);
+    // cells crossed by a module boundary
+    std::vector<bool> moduleBoundary(nCells, false);
+
+    auto cellMin = [&lookup](int i, int j) {
+        return TVector2(lookup.originX + i * lookup.cellSize, lookup.originY + j * lookup.cellSize);
+    };
+
+    auto cellRange = [&lookup](const std::vector<TVector2>& polygon, double margin, int& iMin, int& iMax,
+                               int& jMin, int& jMax) {
+        double x0 = 1E30, x1 = -1E30, y0 = 1E30, y1 = -1E30;
+        for (const auto& vertex : polygon) {
+            x0 = std::min(x0, vertex.X());
+            x1 = std::max(x1, vertex.X());
+            y0 = std::min(y0, vertex.Y());
+            y1 = std::max(y1, vertex.Y());
+        }
+        iMin = std::max(0, static_cast<int>(std::floor((x0 - margin - lookup.originX) / lookup.cellSize)));
+        iMax = std::min(lookup.nX - 1,
+                        static_cast<int>(std::floor((x1 + margin - lookup.originX) / lookup.cellSize)));
+        jMin = std::max(0, static_cast<int>(std::floor((y0 - margin - lookup.originY) / lookup.cellSize)));
+        jMax = std::min(lookup.nY - 1,
+                        static_cast<int>(std::floor((y1 + margin - lookup.originY) / lookup.cellSize)));
+    };
+
+    auto cellInside = [&lookup](const std::vector<TVector2>& polygon, const TVector2& boxMin, double margin) {
+        const TVector2 boxMax = boxMin + TVector2(lookup.cellSize, lookup.cellSize);
+        for (const auto& corner :
+             {boxMin, TVector2(boxMax.X(), boxMin.Y()), boxMax, TVector2(boxMin.X(), boxMax.Y())}) {
+            if (DistanceToConvexPolygon(polygon, corner) >= -margin) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    for (int m = 0; m < plane->GetNumberOfModules(); m++) {
+        auto module = plane->GetModule(m);
+
+        // cells not fully inside the module are resolved by the full query
+        const auto modulePolygon = GetModulePolygon(module);
+        int iMin, iMax, jMin, jMax;
+        cellRange(modulePolygon, tolerance, iMin, iMax, jMin, jMax);
+        for (int j = jMin; j <= jMax; j++) {
+            for (int i = iMin; i <= iMax; i++) {
+                const TVector2 boxMin = cellMin(i, j);
+                const TVector2 boxMax = boxMin + TVector2(lookup.cellSize, lookup.cellSize);
+                if (ConvexPolygonIntersectsBox(modulePolygon, boxMin, boxMax, tolerance) &&
+                    !cellInside(modulePolygon, boxMin, tolerance)) {
+                    moduleBoundary[j * lookup.nX + i] = true;
+                }
+            }
+        }
+
+        for (int c = 0; c < module->GetNumberOfChannels(); c++) {
+            auto channel = module->GetChannel(c);
+            const int daqId = channel->GetDaqID();
+            for (int p = 0; p < channel->GetNumberOfPixels(); p++) {
+                const auto polygon = GetPixelPolygon(module, channel->GetPixel(p));
+                cellRange(polygon, tolerance, iMin, iMax, jMin, jMax);
+                for (int j = jMin; j <= jMax; j++) {
+                    for (int i = iMin; i <= iMax; i++) {
+                        const TVector2 boxMin = cellMin(i, j);
+                        const TVector2 boxMax = boxMin + TVector2(lookup.cellSize, lookup.cellSize);
+                        if (!ConvexPolygonIntersectsBox(polygon, boxMin, boxMax, tolerance)) {
+                            continue;
+                        }
+                        const size_t index = j * lookup.nX + i;
+                        if (!candidates[index].empty()) {
+                            const int first = candidates[index].front();
+                            const int firstDaqId = plane->GetModule(first >> 24)
+                                                       ->GetChannel((first >> 12) & 0xFFF)
+                                                       ->GetDaqID();
+                            severalChannels[index] = severalChannels[index] || firstDaqId != daqId;
+                        }
+                        candidates[index].push_back(ReadoutRasterLookup::EncodeCandidate(m, c, p));
+                        if (cellInside(polygon, boxMin, tolerance)) {
+                            covered[index] = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (int m = 0; m < plane->GetNumberOfModules(); m++) {
+        auto module = plane->GetModule(m);
+        lookup.moduleChannelOffsets.push_back(lookup.channelDaqIds.size());
+        for (int c = 0; c < module->GetNumberOfChannels(); c++) {
+            lookup.channelDaqIds.push_back(module->GetChannel(c)->GetDaqID());
+        }
+    }
+
+    // pixel centers, to order the slots of a block independently of the pixel numbering
+    std::map<int, TVector2> pixelCenters;
+    auto getPixelCenter = [&](int candidate) {
+        auto center = pixelCenters.find(candidate);
+        if (center == pixelCenters.end()) {
+            auto module = plane->GetModule(candidate >> 24);
+            const auto polygon =
+                GetPixelPolygon(module, module->GetChannel((candidate >> 12) & 0xFFF)->GetPixel(candidate & 0xFFF));
+            TVector2 sum;
+            for (const auto& vertex : polygon) {
+                sum += vertex;
+            }
+            center = pixelCenters.emplace(candidate, sum / polygon.size()).first;
+        }
+        return center->second;
+    };
+
+    const int B = subdivisions;
+    std::map<std::vector<unsigned short>, unsigned short> patternIndices;
+    // the first pattern resolves every cell with the full query, used if there are too many patterns
+    const std::vector<unsigned short> fullQueryPattern(B * B, ReadoutRasterLookup::kFullQueryCell);
+    patternIndices[fullQueryPattern] = 0;
+    lookup.patterns = fullQueryPattern;
+
+    std::vector<unsigned short> pattern(B * B);
+    for (int bj = 0; bj < nBlocksY; bj++) {
+        for (int bi = 0; bi < nBlocksX; bi++) {
+            auto cellIndex = [&](int k) { return static_cast<size_t>(bj * B + k / B) * lookup.nX + bi * B + k % B; };
+
+            // pixels needed by the cells of the block, ordered by their position relative to the block
+            std::vector<int> slots;
+            for (int k = 0; k < B * B; k++) {
+                const size_t index = cellIndex(k);
+                if (!moduleBoundary[index]) {
+                    slots.insert(slots.end(), candidates[index].begin(), candidates[index].end());
+                }
+            }
+            const TVector2 blockOrigin = cellMin(bi * B, bj * B);
+            auto key = [&](int candidate) {
+                const TVector2 center = (getPixelCenter(candidate) - blockOrigin) / lookup.cellSize;
+                return std::make_tuple(std::llround(center.Y() * 1024), std::llround(center.X() * 1024), candidate);
+            };
+            std::sort(slots.begin(), slots.end());
+            slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+            std::sort(slots.begin(), slots.end(), [&](int a, int b) { return key(a) < key(b); });
+
+            for (int k = 0; k < B * B; k++) {
+                const size_t index = cellIndex(k);
+                unsigned short& code = pattern[k];
+                if (moduleBoundary[index]) {
+                    code = ReadoutRasterLookup::kFullQueryCell;
+                } else if (candidates[index].empty()) {
+                    code = ReadoutRasterLookup::kEmptyCell;
+                } else if (covered[index] && !severalChannels[index]) {
+                    code = std::find(slots.begin(), slots.end(), candidates[index].front()) - slots.begin();
+                } else {
+                    code = ReadoutRasterLookup::kAmbiguousCell;
+                    for (const int candidate : candidates[index]) {
+                        const int slot = std::find(slots.begin(), slots.end(), candidate) - slots.begin();
+                        if (slot >= ReadoutRasterLookup::kMaxAmbiguousSlots) {
+                            code = ReadoutRasterLookup::kFullQueryCell;
+                            break;
+                        }
+                        code |= 1 << slot;
+                    }
+                }
+            }
+
+            auto patternIndex = patternIndices.find(pattern);
+            if (patternIndex == patternIndices.end() && patternIndices.size() < ReadoutRasterLookup::kEmptyCell) {
+                patternIndex = patternIndices.emplace(pattern, patternIndices.size()).first;
+                lookup.patterns.insert(lookup.patterns.end(), pattern.begin(), pattern.end());
+            }
+            lookup.blockPatterns.push_back(patternIndex == patternIndices.end() ? 0 : patternIndex->second);
+            lookup.slotPixels.insert(lookup.slotPixels.end(), slots.begin(), slots.end());
+            lookup.blockSlotOffsets.push_back(lookup.slotPixels.size());
+        }
+    }
+
+    return lookup;
+}
+
+// Compares the raster lookup with the exact pixel test at `pointsPerCell` x `pointsPerCell` points of every
+// raster cell. Returns the number of points where both disagree.
+inline size_t CheckRasterLookup(const ReadoutRasterLookup& lookup, TRestDetectorReadout* readout,
+                                int pointsPerCell = 1) {
+    const double step = lookup.cellSize / pointsPerCell;
+    // offset the points within the cell so that they do not fall systematically on pixel boundaries
+    const double offset = step * (TMath::Sqrt(2.) - 1.0);
+
+    size_t points = 0, mismatches = 0;
+    for (int j = 0; j < lookup.nY * pointsPerCell; j++) {
+        const double y = lookup.originY + j * step + offset;
+        for (int i = 0; i < lookup.nX * pointsPerCell; i++) {
+            const double x = lookup.originX + i * step + offset;
+            const TVector3 point = lookup.GetPoint(x, y);
+            const int exact = std::get<0>(readout->GetHitsDaqChannelAtReadoutPlane(point, lookup.planeIndex));
+            const int fromLookup = lookup.FindDaqId(point, readout);
+            points++;
+            if (exact != fromLookup) {
+                if (mismatches < 10) {
+                    std::cerr << "Raster lookup mismatch at (" << x << ", " << y << "): lookup DAQ ID "
+                              << fromLookup << ", exact DAQ ID " << exact << std::endl;
+                }
+                mismatches++;
+            }
+        }
+    }
+
+    std::cout << "Raster lookup checked at " << points << " points, " << mismatches << " mismatches"
+              << std::endl;
+    return mismatches;
+}
@@ -0,0 +1,86 @@
+//
+// Veto scintillators and light guides of the geometry, and the margin of the veto readout planes around them.
+//
+
+#pragma once
+
+#include <TGeoBBox.h>
+#include <TGeoManager.h>
+#include <TGeoMatrix.h>
+#include <TGeoNode.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "VetoSpatialIndex.h"
+
+// The veto readout planes extend this much (mm) beyond the scintillator, otherwise some points on the boundary are
+// not assigned to the veto. The distance between vetoes must be larger.
+constexpr double vetoPlaneMargin = 1.0;
+
+struct VetoGeometryVolume {
+    std::string name;        // physical volume names of the path from the world (excluded) joined by "_"
+    std::string parentPath;  // the same for the parent, the scintillator and its light guide share it
+    VetoBox box;             // for the light guides only the center is used
+};
+
+// Scintillator and light guide volumes of a GDML geometry, in traversal order. Lengths are in mm.
+inline void GetVetoGeometryVolumes(const char* gdmlFilename, std::vector<VetoGeometryVolume>& scintillators,
+                                   std::vector<VetoGeometryVolume>& lightGuides) {
+    TGeoManager::Import(gdmlFilename);
+    if (!gGeoManager) {
+        std::cerr << "Failed to import " << gdmlFilename << std::endl;
+        exit(1);
+    }
+    // TGeo lengths are in cm unless the geometry uses Geant4 units
+    const double toMillimeters = TGeoManager::GetDefaultUnits() == TGeoManager::kRootUnits ? 10.0 : 1.0;
+
+    TGeoIterator next(gGeoManager->GetTopVolume());
+    TGeoNode* node;
+    while ((node = next())) {
+        const std::string volumeName = node->GetVolume()->GetName();
+        const bool isScintillator = volumeName.rfind("scintillatorVolume", 0) == 0;
+        const bool isLightGuide = volumeName.rfind("scintillatorLightGuideVolume", 0) == 0;
+        if (!isScintillator && !isLightGuide) {
+            continue;
+        }
+
+        VetoGeometryVolume volume;
+        for (int level = 1; level < next.GetLevel(); level++) {
+            volume.parentPath += std::string(next.GetNode(level)->GetName()) + "_";
+        }
+        volume.name = volume.parentPath + node->GetName();
+
+        const TGeoMatrix* matrix = next.GetCurrentMatrix();
+        const Double_t* translation = matrix->GetTranslation();
+        const Double_t* rotation = matrix->GetRotationMatrix();
+        volume.box.center = TVector3(translation[0], translation[1], translation[2]) * toMillimeters;
+        for (int i = 0; i < 3; i++) {
+            // columns of the rotation matrix are the local axes in the world frame
+            volume.box.axes[i] = TVector3(rotation[i], rotation[3 + i], rotation[6 + i]);
+        }
+        if (isScintillator) {
+            const auto box = dynamic_cast<TGeoBBox*>(node->GetVolume()->GetShape());
+            if (!box) {
+                std::cerr << "Veto volume " << volume.name << " is not a box" << std::endl;
+                exit(1);
+            }
+            volume.box.halfLength[0] = box->GetDX() * toMillimeters;
+            volume.box.halfLength[1] = box->GetDY() * toMillimeters;
+            volume.box.halfLength[2] = box->GetDZ() * toMillimeters;
+        }
+
+        (isScintillator ? scintillators : lightGuides).push_back(volume);
+    }
+}
+
+// Scintillator boxes of a GDML geometry, numbered in traversal order
+inline std::vector<VetoGeometryVolume> GetScintillatorsFromGdml(const char* gdmlFilename) {
+    std::vector<VetoGeometryVolume> scintillators, lightGuides;
+    GetVetoGeometryVolumes(gdmlFilename, scintillators, lightGuides);
+    for (size_t s = 0; s < scintillators.size(); s++) {
+        scintillators[s].box.planeIndex = s;
+    }
+    return scintillators;
+}
@@ -0,0 +1,280 @@
+//
+// Uniform 3D grid over the veto readout planes, each cell keeps the planes whose box intersects it.
+//
+
+#pragma once
+
+#include <TDirectory.h>
+#include <TRestDetectorReadout.h>
+#include <TRestDetectorReadoutModule.h>
+#include <TRestDetectorReadoutPlane.h>
+#include <TVector3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <utility>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../ReadoutUtils.h"
+
+// default cell size (mm) of the index, about the width of a scintillator
+constexpr double vetoIndexCellSize = 50.0;
+
+struct VetoBox {
+    int planeIndex = -1;
+    TVector3 center;
+    TVector3 axes[3];  // axisX, axisY and normal of the readout plane
+    double halfLength[3];
+
+    bool IsInside(const TVector3& point, double margin = 0) const {
+        const TVector3 relative = point - center;
+        for (int i = 0; i < 3; i++) {
+            if (std::abs(relative.Dot(axes[i])) > halfLength[i] + margin) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Axis aligned bounding box
+    void GetBounds(TVector3& min, TVector3& max) const {
+        double extent[3] = {0, 0, 0};
+        for (int i = 0; i < 3; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                extent[i] += halfLength[axis] * std::abs(axes[axis][i]);
+            }
+        }
+        const TVector3 halfExtent(extent[0], extent[1], extent[2]);
+        min = center - halfExtent;
+        max = center + halfExtent;
+    }
+};
+
+// Oriented box covered by a readout plane. Modules are assumed not to be rotated within the plane, as is the
+// case for the veto planes which contain a single module.
+inline VetoBox GetVetoBox(TRestDetectorReadoutPlane* plane, int planeIndex) {
+    const TVector3 normal = plane->GetNormal().Unit();
+    const TVector3 axisX = plane->GetAxisX().Unit();
+    const TVector3 axisY = normal.Cross(axisX);
+
+    double xMin = 1E30, xMax = -1E30, yMin = 1E30, yMax = -1E30;
+    for (int m = 0; m < plane->GetNumberOfModules(); m++) {
+        const auto module = plane->GetModule(m);
+        xMin = std::min(xMin, module->GetOrigin().X());
+        xMax = std::max(xMax, module->GetOrigin().X() + module->GetSize().X());
+        yMin = std::min(yMin, module->GetOrigin().Y());
+        yMax = std::max(yMax, module->GetOrigin().Y() + module->GetSize().Y());
+    }
+
+    VetoBox box;
+    box.planeIndex = planeIndex;
+    box.center = plane->GetPosition() + axisX * ((xMin + xMax) / 2.0) + axisY * ((yMin + yMax) / 2.0) +
+                 normal * (plane->GetHeight() / 2.0);
+    box.axes[0] = axisX;
+    box.axes[1] = axisY;
+    box.axes[2] = normal;
+    box.halfLength[0] = (xMax - xMin) / 2.0;
+    box.halfLength[1] = (yMax - yMin) / 2.0;
+    box.halfLength[2] = plane->GetHeight() / 2.0;
+    return box;
+}
+
+// Separating axis test between two oriented boxes. Boxes only touching (penetration below `margin`) do not
+// intersect.
+inline bool VetoBoxesIntersect(const VetoBox& a, const VetoBox& b, double margin = 0) {
+    std::vector<TVector3> axes;
+    for (int i = 0; i < 3; i++) {
+        axes.push_back(a.axes[i]);
+        axes.push_back(b.axes[i]);
+        for (int j = 0; j < 3; j++) {
+            const TVector3 axis = a.axes[i].Cross(b.axes[j]);
+            if (axis.Mag() > 1E-9) {
+                axes.push_back(axis.Unit());
+            }
+        }
+    }
+
+    const TVector3 distance = b.center - a.center;
+    for (const auto& axis : axes) {
+        double radiusA = 0, radiusB = 0;
+        for (int i = 0; i < 3; i++) {
+            radiusA += a.halfLength[i] * std::abs(a.axes[i].Dot(axis));
+            radiusB += b.halfLength[i] * std::abs(b.axes[i].Dot(axis));
+        }
+        if (std::abs(distance.Dot(axis)) >= radiusA + radiusB - margin) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct VetoSpatialIndex {
+    TVector3 origin;
+    double cellSize = 0;
+    int nX = 0;
+    int nY = 0;
+    int nZ = 0;
+
+    // planes intersecting cell `k` are planes[cellOffsets[k]] ... planes[cellOffsets[k + 1] - 1]
+    std::vector<int> cellOffsets = {0};
+    std::vector<int> planes;
+
+    // Returns the (begin, end) range in `planes` of the candidate planes for `point`
+    std::pair<const int*, const int*> GetCandidatePlanes(const TVector3& point) const {
+        const TVector3 relative = point - origin;
+        const int i = static_cast<int>(std::floor(relative.X() / cellSize));
+        const int j = static_cast<int>(std::floor(relative.Y() / cellSize));
+        const int k = static_cast<int>(std::floor(relative.Z() / cellSize));
+        if (i < 0 || j < 0 || k < 0 || i >= nX || j >= nY || k >= nZ) {
+            return {nullptr, nullptr};
+        }
+        const int cell = (k * nY + j) * nX + i;
+        return {planes.data() + cellOffsets[cell], planes.data() + cellOffsets[cell + 1]};
+    }
+
+    // Same as `TRestDetectorReadout::GetHitsDaqChannelAtReadoutPlane` tried on all the veto planes, returns
+    // (daqId, moduleId, channelId) of the first plane containing the point and -1 for all if there is none
+    std::tuple<int, int, int> GetHitsDaqChannel(const TVector3& point, TRestDetectorReadout* readout,
+                                                int* planeIndex = nullptr) const {
+        const auto [begin, end] = GetCandidatePlanes(point);
+        for (auto plane = begin; plane != end; ++plane) {
+            const auto result = readout->GetHitsDaqChannelAtReadoutPlane(point, *plane);
+            if (std::get<0>(result) != -1) {
+                if (planeIndex) {
+                    *planeIndex = *plane;
+                }
+                return result;
+            }
+        }
+        return {-1, -1, -1};
+    }
+
+    void Write(TDirectory* directory) const {
+        WriteParameters(directory, "vetoIndexGeometry",
+                        {origin.X(), origin.Y(), origin.Z(), cellSize, double(nX), double(nY), double(nZ)});
+        directory->WriteObject(&cellOffsets, "vetoIndexCellOffsets");
+        directory->WriteObject(&planes, "vetoIndexPlanes");
+    }
+
+    bool Read(TDirectory* directory) {
+        std::vector<double> geometry;
+        if (!ReadParameters(directory, "vetoIndexGeometry", 7, geometry) ||
+            !ReadObject(directory, "vetoIndexCellOffsets", cellOffsets) ||
+            !ReadObject(directory, "vetoIndexPlanes", planes)) {
+            return false;
+        }
+        origin = {geometry[0], geometry[1], geometry[2]};
+        cellSize = geometry[3];
+        nX = static_cast<int>(geometry[4]);
+        nY = static_cast<int>(geometry[5]);
+        nZ = static_cast<int>(geometry[6]);
+        return cellOffsets.size() == static_cast<size_t>(nX) * nY * nZ + 1;
+    }
+};
+
+inline std::vector<VetoBox> GetVetoBoxes(TRestDetectorReadout* readout) {
+    std::vector<VetoBox> boxes;
+    for (int p = 0; p < readout->GetNumberOfReadoutPlanes(); p++) {
+        auto plane = readout->GetReadoutPlane(p);
+        if (plane->GetType() == "veto") {
+            boxes.push_back(GetVetoBox(plane, p));
+        }
+    }
+    return boxes;
+}
+
+// Builds the index over `boxes`, whose cells keep the `planeIndex` of the boxes intersecting them. Pairs of plane
+// indices whose boxes overlap are appended to `overlaps`.
+inline VetoSpatialIndex BuildVetoSpatialIndex(const std::vector<VetoBox>& boxes, double cellSize,
+                                              std::vector<std::pair<int, int>>& overlaps) {
+    for (size_t a = 0; a < boxes.size(); a++) {
+        for (size_t b = a + 1; b < boxes.size(); b++) {
+            if (VetoBoxesIntersect(boxes[a], boxes[b], 1E-6)) {
+                overlaps.emplace_back(boxes[a].planeIndex, boxes[b].planeIndex);
+            }
+        }
+    }
+
+    std::vector<TVector3> boxMin(boxes.size()), boxMax(boxes.size());
+    TVector3 gridMin(1E30, 1E30, 1E30), gridMax(-1E30, -1E30, -1E30);
+    for (size_t b = 0; b < boxes.size(); b++) {
+        boxes[b].GetBounds(boxMin[b], boxMax[b]);
+        gridMin.SetXYZ(std::min(gridMin.X(), boxMin[b].X()), std::min(gridMin.Y(), boxMin[b].Y()),
+                       std::min(gridMin.Z(), boxMin[b].Z()));
+        gridMax.SetXYZ(std::max(gridMax.X(), boxMax[b].X()), std::max(gridMax.Y(), boxMax[b].Y()),
+                       std::max(gridMax.Z(), boxMax[b].Z()));
+    }
+
+    VetoSpatialIndex index;
+    if (boxes.empty()) {
+        return index;
+    }
+    index.cellSize = cellSize;
+    index.origin = gridMin;
+    index.nX = static_cast<int>(std::ceil((gridMax.X() - gridMin.X()) / cellSize)) + 1;
+    index.nY = static_cast<int>(std::ceil((gridMax.Y() - gridMin.Y()) / cellSize)) + 1;
+    index.nZ = static_cast<int>(std::ceil((gridMax.Z() - gridMin.Z()) / cellSize)) + 1;
+
+    const size_t nCells = static_cast<size_t>(index.nX) * index.nY * index.nZ;
+    std::vector<std::vector<int>> cellPlanes(nCells);
+
+    for (size_t b = 0; b < boxes.size(); b++) {
+        const TVector3 from = boxMin[b] - gridMin;
+        const TVector3 to = boxMax[b] - gridMin;
+        const int iMin = static_cast<int>(std::floor(from.X() / cellSize));
+        const int jMin = static_cast<int>(std::floor(from.Y() / cellSize));
+        const int kMin = static_cast<int>(std::floor(from.Z() / cellSize));
+        const int iMax = std::min(index.nX - 1, static_cast<int>(std::floor(to.X() / cellSize)));
+        const int jMax = std::min(index.nY - 1, static_cast<int>(std::floor(to.Y() / cellSize)));
+        const int kMax = std::min(index.nZ - 1, static_cast<int>(std::floor(to.Z() / cellSize)));
+
+        for (int k = kMin; k <= kMax; k++) {
+            for (int j = jMin; j <= jMax; j++) {
+                for (int i = iMin; i <= iMax; i++) {
+                    // the cell as an oriented box
+                    VetoBox cell;
+                    cell.center = gridMin + TVector3((i + 0.5) * cellSize, (j + 0.5) * cellSize,
+                                                     (k + 0.5) * cellSize);
+                    cell.axes[0] = {1, 0, 0};
+                    cell.axes[1] = {0, 1, 0};
+                    cell.axes[2] = {0, 0, 1};
+                    // slightly larger so points on the cell faces are always covered
+                    std::fill(cell.halfLength, cell.halfLength + 3, cellSize / 2.0 + 1E-3);
+                    if (VetoBoxesIntersect(cell, boxes[b])) {
+                        cellPlanes[(k * index.nY + j) * index.nX + i].push_back(boxes[b].planeIndex);
+                    }
+                }
+            }
+        }
+    }
+
+    for (const auto& cell : cellPlanes) {
+        index.planes.insert(index.planes.end(), cell.begin(), cell.end());
+        index.cellOffsets.push_back(index.planes.size());
+    }
+
+    return index;
+}
+
+// Builds the index over all the planes of type "veto" of the readout
+inline VetoSpatialIndex BuildVetoSpatialIndex(TRestDetectorReadout* readout, double cellSize,
+                                              std::vector<std::pair<int, int>>& overlaps) {
+    return BuildVetoSpatialIndex(GetVetoBoxes(readout), cellSize, overlaps);
+}
+
+// Index stored in the `<readoutName>_lookup` directory of `file`, or built from the readout if there is none (files
+// written before the lookup tables were added)
+inline VetoSpatialIndex LoadVetoSpatialIndex(TDirectory* file, const std::string& readoutName,
+                                             TRestDetectorReadout* readout) {
+    VetoSpatialIndex index;
+    TDirectory* directory = file->GetDirectory((readoutName + "_lookup").c_str());
+    if (directory && index.Read(directory)) {
+        return index;
+    }
+    std::cout << "No veto spatial index stored for " << readoutName << ", building it" << std::endl;
+    std::vector<std::pair<int, int>> overlaps;
+    return BuildVetoSpatialIndex(readout, vetoIndexCellSize, overlaps);
+}